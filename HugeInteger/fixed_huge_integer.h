@@ -0,0 +1,503 @@
+#ifndef __FIXED_HUGE_INTEGER__
+#define __FIXED_HUGE_INTEGER__
+
+
+#include <cstddef>
+#include <string>
+#include <ostream>
+#include <stdexcept>
+
+#include "huge_integer.h"
+#include "limb_arithmetic.h"
+
+
+// Whether the code runs at compile time (std::is_constant_evaluated of C++20, GCC and Clang have it in C++17 too).
+// At run time FixedHugeInt does what it can by the limb routines shared with HugeInt, with their assembly kernels.
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define FIXED_HUGE_INT_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+#ifndef FIXED_HUGE_INT_IS_CONSTANT_EVALUATED
+#define FIXED_HUGE_INT_IS_CONSTANT_EVALUATED() true
+#endif
+
+
+
+/**
+ * @brief Signed integer of a fixed number of bits in two's complement, wrapping around on overflow like the built-in
+ * integers do. Base integers are the same as of HugeInt, but stored in place - it never allocates memory - and, as all
+ * the loops run over a size known at compile time, the compiler unrolls them instead of checking sizes at run time.
+ * Everything but the conversions to HugeInt and strings is constexpr.
+ */
+template <size_t bits>
+class FixedHugeInt
+{
+    template <size_t> friend class FixedHugeInt;
+
+public:
+    using BaseInt = HugeInt::BaseInt;
+    using BaseUint = HugeInt::BaseUint;
+    using DoubleBaseUint = HugeInt::DoubleBaseUint;
+
+    static constexpr size_t BASE_UINT_BITS = sizeof(BaseUint) * 8;
+    // Number of base integers, the last bit of the last one is a sign bit.
+    static constexpr size_t SIZE = bits / BASE_UINT_BITS;
+    static_assert(bits > 0 && bits % BASE_UINT_BITS == 0, "FixedHugeInt consists of whole base integers.");
+
+private:
+    BaseUint vals[SIZE] = {};
+
+    /**
+     * @brief Absolute value as an unsigned array, the minimum value's one fits too.
+     */
+    constexpr FixedHugeInt get_Magnitude() const
+    {
+        return is_Negative() ? -*this : *this;
+    }
+
+    /**
+     * @brief Number of base integers without the leading zero ones of an unsigned array.
+     */
+    static constexpr size_t get_NormalizedSize(const BaseUint *x)
+    {
+        size_t n = SIZE;
+        while (n > 0 && x[n - 1] == 0)
+            --n;
+        return n;
+    }
+
+    /**
+     * @brief q = u / v, r = u % v of unsigned arrays using Knuth's algorithm D, where v is not zero.
+     */
+    static constexpr void divide_Magnitudes(const BaseUint *u, const BaseUint *v, BaseUint *q, BaseUint *r)
+    {
+        size_t un = get_NormalizedSize(u), vn = get_NormalizedSize(v);
+        for (size_t i = 0; i < SIZE; ++i)
+            q[i] = r[i] = 0;
+        if (un < vn)
+        {
+            for (size_t i = 0; i < un; ++i)
+                r[i] = u[i];
+            return;
+        }
+
+        if (vn == 1)
+        {
+            DoubleBaseUint remainder = 0;
+            for (size_t i = un; i-- > 0;)
+            {
+                DoubleBaseUint current = (remainder << BASE_UINT_BITS) | u[i];
+                q[i] = BaseUint(current / v[0]);
+                remainder = current % v[0];
+            }
+            r[0] = BaseUint(remainder);
+            return;
+        }
+
+        // normalize so that the highest bit of the divisor is set, the dividend gets one more integer
+        unsigned shift = 0;
+        while (!((v[vn - 1] << shift) >> (BASE_UINT_BITS - 1)))
+            ++shift;
+        BaseUint vs[SIZE] = {}, us[SIZE + 1] = {};
+        for (size_t i = 0; i < vn; ++i)
+            vs[i] = (v[i] << shift) | (shift && i ? v[i - 1] >> (BASE_UINT_BITS - shift) : 0);
+        for (size_t i = 0; i <= un; ++i)
+        {
+            BaseUint high = i < un ? u[i] << shift : 0;
+            us[i] = high | (shift && i ? u[i - 1] >> (BASE_UINT_BITS - shift) : 0);
+        }
+
+        for (size_t j = un - vn + 1; j-- > 0;)
+        {
+            // estimate of the quotient integer by the top two integers, at most 2 more than the right one
+            DoubleBaseUint top = (DoubleBaseUint(us[j + vn]) << BASE_UINT_BITS) | us[j + vn - 1];
+            DoubleBaseUint q_hat = top / vs[vn - 1], r_hat = top % vs[vn - 1];
+            while ((q_hat >> BASE_UINT_BITS) ||
+                   q_hat * vs[vn - 2] > ((r_hat << BASE_UINT_BITS) | us[j + vn - 2]))
+            {
+                --q_hat;
+                r_hat += vs[vn - 1];
+                if (r_hat >> BASE_UINT_BITS)
+                    break;
+            }
+
+            BaseUint carry = 0, borrow = 0;
+            for (size_t i = 0; i <= vn; ++i)
+            {
+                DoubleBaseUint p = q_hat * (i < vn ? vs[i] : 0) + carry;
+                carry = BaseUint(p >> BASE_UINT_BITS);
+                BaseUint x = us[i + j], low = BaseUint(p);
+                BaseUint d = x - low;
+                BaseUint next_borrow = (x < low) | (d < borrow);
+                us[i + j] = d - borrow;
+                borrow = next_borrow;
+            }
+
+            // the estimate was one too large, add the divisor back
+            if (borrow)
+            {
+                --q_hat;
+                BaseUint add_carry = 0;
+                for (size_t i = 0; i < vn; ++i)
+                {
+                    DoubleBaseUint s = DoubleBaseUint(us[i + j]) + vs[i] + add_carry;
+                    us[i + j] = BaseUint(s);
+                    add_carry = BaseUint(s >> BASE_UINT_BITS);
+                }
+                us[j + vn] += add_carry;
+            }
+            q[j] = BaseUint(q_hat);
+        }
+
+        for (size_t i = 0; i < vn; ++i)
+            r[i] = (us[i] >> shift) | (shift ? us[i + 1] << (BASE_UINT_BITS - shift) : 0);
+    }
+
+    /**
+     * @brief Divide rounding towards zero, the remainder has the sign of the dividend. Throws std::domain_error if
+     * 'b' is zero. Either of the results may be the same object as 'a' or 'b'.
+     */
+    static constexpr void divide(const FixedHugeInt &a, const FixedHugeInt &b, FixedHugeInt &q, FixedHugeInt &r)
+    {
+        if (b.is_Zero())
+            throw std::domain_error("FixedHugeInt division by zero.");
+        bool a_negative = a.is_Negative(), b_negative = b.is_Negative();
+        FixedHugeInt a_magnitude = a.get_Magnitude(), b_magnitude = b.get_Magnitude();
+        divide_Magnitudes(a_magnitude.vals, b_magnitude.vals, q.vals, r.vals);
+        if (a_negative != b_negative)
+            q = -q;
+        if (a_negative)
+            r = -r;
+    }
+
+    /**
+     * @brief Value of a hexadecimal or a decimal digit, or -1 for other characters.
+     */
+    static constexpr int get_DigitValue(char c, unsigned base)
+    {
+        int value = -1;
+        if (c >= '0' && c <= '9')
+            value = c - '0';
+        else if (base == 16 && c >= 'a' && c <= 'f')
+            value = c - 'a' + 10;
+        else if (base == 16 && c >= 'A' && c <= 'F')
+            value = c - 'A' + 10;
+        return value;
+    }
+
+    constexpr void parse(const char *value)
+    {
+        bool is_negative = *value == '-';
+        if (is_negative)
+            ++value;
+        unsigned base = 10;
+        if (value[0] == '0' && (value[1] == 'x' || value[1] == 'X'))
+        {
+            base = 16;
+            value += 2;
+        }
+        if (!*value)
+            throw std::invalid_argument("FixedHugeInt can't be initialized from a string without digits.");
+
+        for (; *value; ++value)
+        {
+            int digit = get_DigitValue(*value, base);
+            if (digit < 0)
+                throw std::invalid_argument("FixedHugeInt can only be initialized from a decimal or a hexadecimal number.");
+            BaseUint carry = BaseUint(digit);
+            for (size_t i = 0; i < SIZE; ++i)
+            {
+                DoubleBaseUint p = DoubleBaseUint(vals[i]) * base + carry;
+                vals[i] = BaseUint(p);
+                carry = BaseUint(p >> BASE_UINT_BITS);
+            }
+        }
+        if (is_negative)
+            *this = -*this;
+    }
+
+public:
+    // Initialize from base integer.
+    constexpr FixedHugeInt(BaseInt value = 0)
+    {
+        vals[0] = BaseUint(value);
+        for (size_t i = 1; i < SIZE; ++i)
+            vals[i] = value < 0 ? ~BaseUint(0) : 0;
+    }
+
+    // Initialize from a decimal number, optionally preceded by '-', or from a hexadecimal one prefixed with 0x.
+    // Both wrap around to the bits. Throws std::invalid_argument on anything else.
+    template <size_t length>
+    constexpr explicit FixedHugeInt(const char (&value)[length])
+    {
+        parse(value);
+    }
+
+    explicit FixedHugeInt(const std::string &value)
+    {
+        parse(value.c_str());
+    }
+
+    // Initialize from little-endian array of base integers in two's complement, truncated or sign extended.
+    constexpr FixedHugeInt(const BaseUint *base_uints, size_t count)
+    {
+        BaseUint extension = count && (base_uints[count - 1] >> (BASE_UINT_BITS - 1)) ? ~BaseUint(0) : 0;
+        for (size_t i = 0; i < SIZE; ++i)
+            vals[i] = i < count ? base_uints[i] : extension;
+    }
+
+    // Lowest bits of a HugeInt, like a conversion to a narrower built-in integer.
+    explicit FixedHugeInt(const HugeInt &value)
+    {
+        BaseUint extension = value.is_Negative() ? ~BaseUint(0) : 0;
+        for (size_t i = 0; i < SIZE; ++i)
+            vals[i] = i < value.size ? value.get_BaseUints()[i] : extension;
+    }
+
+    // Same value of another width, truncated or sign extended.
+    template <size_t other_bits>
+    constexpr explicit FixedHugeInt(const FixedHugeInt<other_bits> &other)
+    {
+        BaseUint extension = other.is_Negative() ? ~BaseUint(0) : 0;
+        for (size_t i = 0; i < SIZE; ++i)
+            vals[i] = i < other.SIZE ? other.vals[i] : extension;
+    }
+
+    HugeInt to_HugeInt() const
+    {
+        return HugeInt(vals, SIZE);
+    }
+
+
+    constexpr BaseUint get_BaseUint(size_t i) const
+    {
+        return vals[i];
+    }
+
+    constexpr const BaseUint *get_BaseUints() const
+    {
+        return vals;
+    }
+
+    constexpr bool is_Negative() const
+    {
+        return vals[SIZE - 1] >> (BASE_UINT_BITS - 1);
+    }
+
+    constexpr bool is_Zero() const
+    {
+        for (size_t i = 0; i < SIZE; ++i)
+        {
+            if (vals[i])
+                return false;
+        }
+        return true;
+    }
+
+
+    constexpr FixedHugeInt& operator+=(const FixedHugeInt &arg)
+    {
+        BaseUint carry = 0;
+        for (size_t i = 0; i < SIZE; ++i)
+        {
+            DoubleBaseUint s = DoubleBaseUint(vals[i]) + arg.vals[i] + carry;
+            vals[i] = BaseUint(s);
+            carry = BaseUint(s >> BASE_UINT_BITS);
+        }
+        return *this;
+    }
+
+    constexpr FixedHugeInt& operator-=(const FixedHugeInt &arg)
+    {
+        BaseUint borrow = 0;
+        for (size_t i = 0; i < SIZE; ++i)
+        {
+            BaseUint a_i = vals[i], b_i = arg.vals[i];
+            BaseUint d = a_i - b_i;
+            BaseUint next_borrow = (a_i < b_i) | (d < borrow);
+            vals[i] = d - borrow;
+            borrow = next_borrow;
+        }
+        return *this;
+    }
+
+    constexpr FixedHugeInt& operator*=(const FixedHugeInt &arg)
+    {
+        // only the products landing in the low SIZE integers are computed, and none of the leading zeros of the
+        // operands (values are often kept twice as wide as they are, for their products to fit)
+        BaseUint product[SIZE] = {};
+        size_t an = get_NormalizedSize(vals), bn = get_NormalizedSize(arg.vals);
+        if (!FIXED_HUGE_INT_IS_CONSTANT_EVALUATED() && an && bn && an + bn <= SIZE)
+        {
+            // the whole product fits, the rows are done by the same kernels as of HugeInt
+            if (an >= bn)
+                limbs::multiply_Schoolbook(product, vals, an, arg.vals, bn);
+            else
+                limbs::multiply_Schoolbook(product, arg.vals, bn, vals, an);
+            an = 0;
+        }
+        for (size_t i = 0; i < an; ++i)
+        {
+            BaseUint carry = 0;
+            size_t j = 0;
+            for (; j < bn && i + j < SIZE; ++j)
+            {
+                DoubleBaseUint p = DoubleBaseUint(vals[i]) * arg.vals[j] + product[i + j] + carry;
+                product[i + j] = BaseUint(p);
+                carry = BaseUint(p >> BASE_UINT_BITS);
+            }
+            if (i + j < SIZE)
+                product[i + j] = carry;
+        }
+        for (size_t i = 0; i < SIZE; ++i)
+            vals[i] = product[i];
+        return *this;
+    }
+
+    constexpr FixedHugeInt& operator/=(const FixedHugeInt &arg)
+    {
+        FixedHugeInt remainder;
+        divide(*this, arg, *this, remainder);
+        return *this;
+    }
+
+    constexpr FixedHugeInt& operator%=(const FixedHugeInt &arg)
+    {
+        FixedHugeInt quotient;
+        divide(*this, arg, quotient, *this);
+        return *this;
+    }
+
+    constexpr FixedHugeInt& operator&=(const FixedHugeInt &arg)
+    {
+        for (size_t i = 0; i < SIZE; ++i)
+            vals[i] &= arg.vals[i];
+        return *this;
+    }
+
+    constexpr FixedHugeInt& operator|=(const FixedHugeInt &arg)
+    {
+        for (size_t i = 0; i < SIZE; ++i)
+            vals[i] |= arg.vals[i];
+        return *this;
+    }
+
+    constexpr FixedHugeInt& operator^=(const FixedHugeInt &arg)
+    {
+        for (size_t i = 0; i < SIZE; ++i)
+            vals[i] ^= arg.vals[i];
+        return *this;
+    }
+
+    constexpr FixedHugeInt& operator<<=(size_t shift)
+    {
+        size_t base_uint_shift = shift / BASE_UINT_BITS;
+        unsigned bit_shift = shift % BASE_UINT_BITS;
+        for (size_t i = SIZE; i-- > 0;)
+        {
+            BaseUint x = i >= base_uint_shift ? vals[i - base_uint_shift] : 0;
+            BaseUint lower = i > base_uint_shift ? vals[i - base_uint_shift - 1] : 0;
+            vals[i] = bit_shift ? (x << bit_shift) | (lower >> (BASE_UINT_BITS - bit_shift)) : x;
+        }
+        return *this;
+    }
+
+    // Arithmetic shift, negative values are rounded towards minus infinity.
+    constexpr FixedHugeInt& operator>>=(size_t shift)
+    {
+        BaseUint extension = is_Negative() ? ~BaseUint(0) : 0;
+        size_t base_uint_shift = shift / BASE_UINT_BITS;
+        unsigned bit_shift = shift % BASE_UINT_BITS;
+        for (size_t i = 0; i < SIZE; ++i)
+        {
+            size_t j = i + base_uint_shift;
+            BaseUint x = j < SIZE ? vals[j] : extension;
+            BaseUint higher = j + 1 < SIZE ? vals[j + 1] : extension;
+            vals[i] = bit_shift ? (x >> bit_shift) | (higher << (BASE_UINT_BITS - bit_shift)) : x;
+        }
+        return *this;
+    }
+
+
+    constexpr FixedHugeInt operator-() const
+    {
+        FixedHugeInt result = ~*this;
+        return result += 1;
+    }
+
+    constexpr FixedHugeInt operator~() const
+    {
+        FixedHugeInt result;
+        for (size_t i = 0; i < SIZE; ++i)
+            result.vals[i] = ~vals[i];
+        return result;
+    }
+
+    constexpr FixedHugeInt operator+(const FixedHugeInt &arg) const { return FixedHugeInt(*this) += arg; }
+    constexpr FixedHugeInt operator-(const FixedHugeInt &arg) const { return FixedHugeInt(*this) -= arg; }
+    constexpr FixedHugeInt operator*(const FixedHugeInt &arg) const { return FixedHugeInt(*this) *= arg; }
+    // Division rounds towards zero and the remainder has the sign of the dividend, as for built-in integers.
+    // Both throw std::domain_error on division by zero.
+    constexpr FixedHugeInt operator/(const FixedHugeInt &arg) const { return FixedHugeInt(*this) /= arg; }
+    constexpr FixedHugeInt operator%(const FixedHugeInt &arg) const { return FixedHugeInt(*this) %= arg; }
+    constexpr FixedHugeInt operator&(const FixedHugeInt &arg) const { return FixedHugeInt(*this) &= arg; }
+    constexpr FixedHugeInt operator|(const FixedHugeInt &arg) const { return FixedHugeInt(*this) |= arg; }
+    constexpr FixedHugeInt operator^(const FixedHugeInt &arg) const { return FixedHugeInt(*this) ^= arg; }
+    constexpr FixedHugeInt operator<<(size_t shift) const { return FixedHugeInt(*this) <<= shift; }
+    constexpr FixedHugeInt operator>>(size_t shift) const { return FixedHugeInt(*this) >>= shift; }
+
+
+    constexpr bool operator==(const FixedHugeInt &arg) const
+    {
+        for (size_t i = 0; i < SIZE; ++i)
+        {
+            if (vals[i] != arg.vals[i])
+                return false;
+        }
+        return true;
+    }
+
+    constexpr bool operator<(const FixedHugeInt &arg) const
+    {
+        if (is_Negative() != arg.is_Negative())
+            return is_Negative();
+        // of the same sign two's complement arrays compare as unsigned ones
+        for (size_t i = SIZE; i-- > 0;)
+        {
+            if (vals[i] != arg.vals[i])
+                return vals[i] < arg.vals[i];
+        }
+        return false;
+    }
+
+    constexpr bool operator!=(const FixedHugeInt &arg) const { return !(*this == arg); }
+    constexpr bool operator>(const FixedHugeInt &arg) const { return arg < *this; }
+    constexpr bool operator<=(const FixedHugeInt &arg) const { return !(arg < *this); }
+    constexpr bool operator>=(const FixedHugeInt &arg) const { return !(*this < arg); }
+
+
+    // Convert to a string in base 10 (signed) or 16 (two's complement of all the bits, bits / 4 digits prefixed with 0x).
+    std::string to_String(int base = 16) const
+    {
+        if (base != 16)
+            return to_HugeInt().to_String(base);
+
+        static constexpr char hex_digits[] = "0123456789abcdef";
+        std::string result(2 + bits / 4, '0');
+        result[1] = 'x';
+        for (size_t d = 0; d < bits / 4; ++d)
+            result[result.size() - 1 - d] = hex_digits[(vals[4 * d / BASE_UINT_BITS] >> (4 * d % BASE_UINT_BITS)) & 0xf];
+        return result;
+    }
+};
+
+
+template <size_t bits>
+std::ostream& operator<<(std::ostream &os, const FixedHugeInt<bits> &x)
+{
+    return os << x.to_String();
+}
+
+
+#endif
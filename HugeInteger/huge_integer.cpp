@@ -1,104 +1,123 @@
 #include "huge_integer.h"
+#include "limb_arithmetic.h"
+#include "limb_allocator.h"
+#include "montgomery.h"
 #include <vector>
-#include <sstream>
-#include <iomanip>
-#include <regex>
-#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <string_view>
 
 
 
-HugeInt::HugeInt(BaseInt val) : size(0)
+size_t HugeInt::karatsuba_threshold = 32;
+size_t HugeInt::karatsuba_square_threshold = 64;
+size_t HugeInt::toom3_threshold = 128;
+// NTT works on 32-bit digits regardless of the base integer size, so with 64-bit ones it pays off later
+size_t HugeInt::ntt_threshold = HUGE_INT_BASE_BITS == 64 ? 65536 : 32768;
+size_t HugeInt::burnikel_ziegler_threshold = 32;
+size_t HugeInt::half_gcd_threshold = 48;
+size_t HugeInt::multiplication_threads = 1;
+size_t HugeInt::parallel_threshold = 4096;
+
+
+/**
+ * @brief Number of integers needed, n or n + 1, when the n + 1-th integer of the result is just a sign extension or not.
+ */
+static inline size_t get_SignedSize(const HugeInt::BaseUint *x, size_t n)
 {
-    data.static_val = val;
+    static constexpr size_t base_uint_bits = sizeof(HugeInt::BaseUint) * 8;
+    HugeInt::BaseUint sign_extension = (x[n - 1] >> (base_uint_bits - 1)) ? ~HugeInt::BaseUint(0) : 0;
+    return x[n] == sign_extension ? n : n + 1;
 }
 
 
-static void extract_FirstNumber(std::string &value, bool &is_negative)
+/**
+ * @brief Number of integers without the leading ones that are just sign extensions of the rest.
+ */
+static inline size_t get_TrimmedSize(const HugeInt::BaseUint *x, size_t n)
 {
-    std::regex regex("(\\d+|-\\d+)");
-    std::sregex_iterator first_num(value.begin(), value.end(), regex);
-    if (first_num == std::sregex_iterator())
-        value = "";
+    while (n > 1 && get_SignedSize(x, n - 1) == n - 1)
+        --n;
+    return n;
+}
+
 
-    value = first_num->str();
-    is_negative = value[0] == '-';
+HugeInt::HugeInt(BaseInt val) : size(1), capacity(INLINE_CAPACITY)
+{
+    data.inline_vals[0] = val;
 }
 
 
-static constexpr double log_2_10 = 3.32192809;
+/**
+ * @brief Find the first number (digits optionally preceded by '-') in the string.
+ * Returns pointer to its first digit or nullptr if there are no digits at all.
+ */
+static const char *find_FirstNumber(const std::string &value, size_t &num_digits, bool &is_negative)
+{
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+
+    auto first_digit = std::find_if(value.begin(), value.end(), is_digit);
+    if (first_digit == value.end())
+        return nullptr;
 
+    is_negative = first_digit != value.begin() && first_digit[-1] == '-';
+    num_digits = std::find_if_not(first_digit, value.end(), is_digit) - first_digit;
+    return &*first_digit;
+}
 
 
-HugeInt::HugeInt(std::string value)
+HugeInt::HugeInt(std::string value) : HugeInt(0)
 {
+    size_t num_digits;
     bool is_negative;
-    extract_FirstNumber(value, is_negative);
+    const char *digits = find_FirstNumber(value, num_digits, is_negative);
+    if (!digits)
+        return;
 
-    size_t num_digits = value.size();
-    if (is_negative && num_digits > 0)
-        --num_digits;
+    std::vector<BaseUint> base_uints = limbs::parse_Decimal(digits, num_digits);
+    if (base_uints.empty())
+        return;
 
-    size = std::ceil(value.size() * (log_2_10 / (sizeof(BaseUint) * 8)));
-    if (size > 1)
-        data.ptr = new BaseUint[size]();
-    else
-    {
-        size = 0; data.static_val = 0;
-    }
+    // the magnitude must leave room for the sign bit
+    if (base_uints.back() >> (sizeof(BaseUint) * 8 - 1))
+        base_uints.push_back(0);
+    if (is_negative)
+        limbs::negate_Limbs(base_uints.data(), base_uints.size());
 
-    HugeInt power_of_10(size, 0), decimal_base(size, 0);
-    power_of_10.set_BaseUint(0, 1);
+    *this = HugeInt(base_uints.data(), base_uints.size());
+}
 
-    auto value_rend = value.rend() - int(is_negative);
 
-    for (auto it = value.rbegin(); it != value_rend; ++it)
-    {
-        BaseUint digit = *it - '0';
-        power_of_10.copy_and_shift_ContentsTo(decimal_base, 0);
-        multiply_by_BaseUint(decimal_base, is_negative ? -digit : digit);
-        sum(*this, decimal_base);
-        multiply_by_BaseUint(power_of_10, 10);
-    }
+HugeInt::HugeInt(const BaseUint *base_uints, size_t count) : HugeInt(count, 0)
+{
+    std::copy(base_uints, base_uints + count, get_BaseUints());
+    size = get_TrimmedSize(get_BaseUints(), size);
 }
 
 
-HugeInt::HugeInt(const HugeInt &other) : data(other.data), size(other.size)
+HugeInt::HugeInt(const HugeInt &other) : HugeInt(other.size, 0)
 {
-    if (size > 0)
-    {
-        data.ptr = new BaseUint[size]();
-        std::copy(other.data.ptr, other.data.ptr + size, data.ptr);
-    }
+    std::copy(other.get_BaseUints(), other.get_BaseUints() + size, get_BaseUints());
 }
 
 
-HugeInt::HugeInt(HugeInt &&other) noexcept : data(other.data), size(other.size)
+HugeInt::HugeInt(HugeInt &&other) noexcept : data(other.data), size(other.size), capacity(other.capacity)
 {
-    if (other.size > 0)
+    if (!other.is_Inline())
     {
-        other.data.ptr = nullptr;
-        other.size = 0;
+        other.size = 1;
+        other.capacity = INLINE_CAPACITY;
+        other.data.inline_vals[0] = 0;
     }
 }
 
 
 HugeInt& HugeInt::operator=(const HugeInt &rhs)
 {
-    if (rhs.size > 0)
-    {
-        if (size >= rhs.size)
-            std::copy(rhs.data.ptr, rhs.data.ptr + rhs.size, data.ptr);
-        else
-        {
-            auto *data_ptr = new BaseUint[rhs.size]();
-            std::copy(rhs.data.ptr, rhs.data.ptr + rhs.size, data_ptr);
-            if (size > 0)
-                delete[] data.ptr;
-            data.ptr = data_ptr;
-        }
-    }
-    else
-        data = rhs.data;
+    if (capacity < rhs.size)
+        reallocate(rhs.size, 0);
+    std::copy(rhs.get_BaseUints(), rhs.get_BaseUints() + rhs.size, get_BaseUints());
     size = rhs.size;
     return *this;
 }
@@ -106,169 +125,727 @@ HugeInt& HugeInt::operator=(const HugeInt &rhs)
 
 HugeInt& HugeInt::operator=(HugeInt &&rhs) noexcept
 {
-    if (size > 0)
-        delete[] data.ptr;
+    if (rhs.is_Inline())
+    {
+        // nothing to steal, keep the own memory
+        std::copy(rhs.data.inline_vals, rhs.data.inline_vals + rhs.size, get_BaseUints());
+        size = rhs.size;
+        return *this;
+    }
+
+    free_Memory();
 
     data = rhs.data;
     size = rhs.size;
+    capacity = rhs.capacity;
 
-    if (rhs.size > 0)
-    {
-        rhs.data.ptr = nullptr;
-        rhs.size = 0;
-    }
+    rhs.size = 1;
+    rhs.capacity = INLINE_CAPACITY;
+    rhs.data.inline_vals[0] = 0;
     return *this;
 }
 
 
 HugeInt::~HugeInt()
 {
-    if (size > 0)
-        delete[] data.ptr;
+    free_Memory();
 }
 
 
 HugeInt::HugeInt(size_t size, size_t additional_capacity)
+    : size(std::max<size_t>(size, 1)), capacity(INLINE_CAPACITY)
 {
-    size_t capacity = size + additional_capacity;
-    if (capacity > 1)
-    {
-        this->size = size;
-        data.ptr = new BaseUint[capacity]();
-    }
-    else
-    {
-        this->size = 0;
-        data.static_val = 0;
-    }
+    size_t min_capacity = this->size + additional_capacity;
+    if (min_capacity > INLINE_CAPACITY)
+        reallocate(min_capacity, 0);
+    std::fill(get_BaseUints(), get_BaseUints() + capacity, 0);
 }
 
 
+void HugeInt::reallocate(size_t new_capacity, size_t num_kept)
+{
+    LimbAllocator &allocator = get_CurrentLimbAllocator();
+    BaseUint *ptr = allocator.allocate(new_capacity);
+    std::copy(get_BaseUints(), get_BaseUints() + num_kept, ptr);
+    free_Memory();
+
+    data.heap.ptr = ptr;
+    data.heap.allocator = &allocator;
+    capacity = new_capacity;
+}
 
 
-static inline char sign(HugeInt::BaseInt x)
+void HugeInt::free_Memory()
 {
-    return x > 0 ? 1 : x ? -1 : 0;
+    if (!is_Inline())
+        data.heap.allocator->deallocate(data.heap.ptr, capacity);
 }
-/**
- * @brief Sum of two base unsigned integers and a carry.
- *
- * @param a First int
- * @param b Second int
- * @param c Carry
- * @return Sum
- */
-static inline HugeInt::BaseUint sum_BaseUints(HugeInt::BaseUint a, HugeInt::BaseUint b, char &c)
+
+
+void HugeInt::reserve_Capacity(size_t min_capacity)
 {
-    HugeInt::BaseUint s = a + b + c;
-    c = b >= ~c || (b + c) >= ~a;
-    return s;
+    if (capacity >= min_capacity)
+        return;
+
+    reallocate(std::max(min_capacity, 2 * capacity), size);
 }
 
 
-char HugeInt::sum(HugeInt &a, const HugeInt &b, char carry)
+void HugeInt::normalize()
 {
-    for (size_t i = 0; i < a.get_TechnicalSize(); ++i)
-        a.set_BaseUint(i, sum_BaseUints(a.get_BaseUint(i), b.get_BaseUint(i), carry));
-    return carry;
+    size = get_TrimmedSize(get_BaseUints(), size);
 }
 
 
-void HugeInt::multiply(const HugeInt &a, const HugeInt &b, HugeInt &c, HugeInt &temp_var)
+HugeInt HugeInt::make_Uninitialized(size_t size)
 {
-    size_t a_size = a.get_TechnicalSize();
-    size_t b_size = b.get_TechnicalSize();
+    HugeInt result(0);
+    if (size > INLINE_CAPACITY)
+        result.reallocate(size, 0);
+    result.size = size;
+    return result;
+}
+
 
-    for (size_t i = 0; i < b_size; ++i)
+void HugeInt::sum(const HugeInt &a, const HugeInt &b, HugeInt &c)
+{
+    static constexpr size_t base_uint_bits = sizeof(BaseUint) * 8;
+
+    const HugeInt &longer = a.size >= b.size ? a : b;
+    const HugeInt &shorter = a.size >= b.size ? b : a;
+    size_t n = longer.size, m = shorter.size;
+    const BaseUint *longer_data = longer.get_BaseUints();
+    const BaseUint *shorter_data = shorter.get_BaseUints();
+    // the shorter one is sign extended to the length of the longer one and both - to one integer more
+    BaseUint longer_extension = longer.is_Negative() ? ~BaseUint(0) : 0;
+    BaseUint shorter_extension = shorter.is_Negative() ? ~BaseUint(0) : 0;
+    // may be the same array as one of the above, but each integer is read before it's overwritten
+    BaseUint *c_data = c.get_BaseUints();
+
+    BaseUint carry = limbs::add_Limbs(c_data, longer_data, shorter_data, m);
+    for (size_t i = m; i < n; ++i)
     {
-        temp_var.clear();
-        a.copy_and_shift_ContentsTo(temp_var, i);
-        multiply_by_BaseUint(temp_var, b.get_BaseUint(i));
-        sum(c, temp_var);
+        DoubleBaseUint s = DoubleBaseUint(longer_data[i]) + shorter_extension + carry;
+        c_data[i] = BaseUint(s);
+        carry = BaseUint(s >> base_uint_bits);
     }
+    c_data[n] = longer_extension + shorter_extension + carry;
+
+    // the last integer is needed only if the signed sum overloaded, and fewer if the operands cancelled out
+    c.size = get_TrimmedSize(c_data, n + 1);
 }
 
 
-void HugeInt::multiply_by_BaseUint(HugeInt &a, BaseUint b)
+void HugeInt::subtract(const HugeInt &a, const HugeInt &b, HugeInt &c)
 {
-    DoubleBaseUint m = 0;
-    static constexpr size_t base_int_bits = sizeof(BaseUint) * 8;
-    static constexpr DoubleBaseUint leading_ones_filter = DoubleBaseUint(~0) >> base_int_bits;
-    for (size_t i = 0; i < a.get_TechnicalSize(); ++i)
+    size_t n = std::max(a.size, b.size), m = std::min(a.size, b.size);
+    const BaseUint *a_data = a.get_BaseUints();
+    const BaseUint *b_data = b.get_BaseUints();
+    BaseUint a_extension = a.is_Negative() ? ~BaseUint(0) : 0;
+    BaseUint b_extension = b.is_Negative() ? ~BaseUint(0) : 0;
+    BaseUint *c_data = c.get_BaseUints();
+
+    BaseUint borrow = limbs::subtract_Limbs(c_data, a_data, b_data, m);
+    for (size_t i = m; i <= n; ++i)
     {
-        m = (DoubleBaseUint(a.get_BaseUint(i)) & leading_ones_filter) * (b & leading_ones_filter) + (m >> base_int_bits);
-        a.set_BaseUint(i, m);
+        BaseUint a_i = i < a.size ? a_data[i] : a_extension;
+        BaseUint b_i = i < b.size ? b_data[i] : b_extension;
+        BaseUint d = a_i - b_i;
+        BaseUint next_borrow = a_i < b_i || d < borrow;
+        c_data[i] = d - borrow;
+        borrow = next_borrow;
     }
+
+    c.size = get_TrimmedSize(c_data, n + 1);
 }
 
 
-HugeInt HugeInt::operator+(const HugeInt &arg) const
+const HugeInt::BaseUint *HugeInt::get_Magnitude(HugeInt &buffer, size_t &magnitude_size) const
 {
-    if (size == 0 && arg.size == 0)
+    const BaseUint *x = get_BaseUints();
+    if (is_Negative())
     {
-        // case when both operands are statically sized integers and we check if the sum of them can also be like them
-        char this_sign = sign(data.static_val);
-        char arg_sign = sign(arg.data.static_val);
-        char carry = 0;
-        BaseUint result = sum_BaseUints(data.static_val, arg.data.static_val, carry);
-
-        // if unsigned sum overloaded (aka returned a carry) and signed arguments we identically signed, then 'signed sum' also overloaded
-        if (carry && this_sign * arg_sign > 0)
+        buffer = *this;
+        limbs::negate_Limbs(buffer.get_BaseUints(), size);
+        x = buffer.get_BaseUints();
+    }
+    magnitude_size = limbs::get_NormalizedSize(x, size);
+    return x;
+}
+
+
+void HugeInt::multiply(const HugeInt &a, const HugeInt &b, HugeInt &c)
+{
+    size_t c_size = c.size;
+    BaseUint *c_data = c.get_BaseUints();
+
+    HugeInt a_buffer(0), b_buffer(0);
+    size_t a_size, b_size;
+    const BaseUint *a_data = a.get_Magnitude(a_buffer, a_size);
+    // the same magnitude array for both makes the limb multiplication square
+    const BaseUint *b_data = &a == &b ? a_data : b.get_Magnitude(b_buffer, b_size);
+    if (&a == &b)
+        b_size = a_size;
+
+    std::fill(c_data, c_data + c_size, 0);
+    if (a_size == 0 || b_size == 0)
+    {
+        c.size = 1;
+        return;
+    }
+
+    if (a_size >= b_size)
+        limbs::multiply_Limbs(c_data, a_data, a_size, b_data, b_size);
+    else
+        limbs::multiply_Limbs(c_data, b_data, b_size, a_data, a_size);
+
+    if (a.is_Negative() != b.is_Negative())
+        limbs::negate_Limbs(c_data, c_size);
+    c.size = get_TrimmedSize(c_data, c_size);
+}
+
+
+void HugeInt::divide(const HugeInt &a, const HugeInt &b, HugeInt *q, HugeInt *r)
+{
+    HugeInt a_buffer(0), b_buffer(0);
+    size_t a_size, b_size;
+    const BaseUint *a_data = a.get_Magnitude(a_buffer, a_size);
+    const BaseUint *b_data = b.get_Magnitude(b_buffer, b_size);
+    if (b_size == 0)
+        throw std::domain_error("HugeInt division by zero.");
+
+    // magnitudes of the results with one integer more for the sign bit
+    size_t q_size = a_size >= b_size ? a_size - b_size + 1 : 0;
+    HugeInt quotient(q_size + 1, 0), remainder(b_size + 1, 0);
+    BaseUint *q_data = quotient.get_BaseUints();
+    BaseUint *r_data = remainder.get_BaseUints();
+    if (q_size == 0)
+        std::copy(a_data, a_data + a_size, r_data);
+    else
+        limbs::divide_Limbs(q_data, r_data, a_data, a_size, b_data, b_size);
+
+    bool a_negative = a.is_Negative(), b_negative = b.is_Negative();
+    if (a_negative != b_negative)
+        limbs::negate_Limbs(q_data, quotient.size);
+    if (a_negative)
+        limbs::negate_Limbs(r_data, remainder.size);
+    quotient.size = get_TrimmedSize(q_data, quotient.size);
+    remainder.size = get_TrimmedSize(r_data, remainder.size);
+
+    // 'a' and 'b' aren't needed anymore, so they may be overwritten
+    if (q)
+        *q = std::move(quotient);
+    if (r)
+        *r = std::move(remainder);
+}
+
+
+void HugeInt::evaluate(const HugeIntTerm *terms, size_t num_terms, bool accumulate)
+{
+    // x = x + ... is the same as x += ...
+    if (!accumulate && num_terms > 0 && !terms[0].b && !terms[0].negative && terms[0].a == this)
+    {
+        ++terms, --num_terms;
+        accumulate = true;
+    }
+
+    // sums and differences of two values are done in a single pass by sum() and subtract(), which allow aliasing
+    if (!accumulate && num_terms == 2 && !terms[0].b && !terms[1].b && !terms[0].negative)
+    {
+        reserve_Capacity(std::max(terms[0].a->size, terms[1].a->size) + 1);
+        (terms[1].negative ? subtract : sum)(*terms[0].a, *terms[1].a, *this);
+        return;
+    }
+    if (accumulate && num_terms == 1 && !terms[0].b)
+    {
+        reserve_Capacity(std::max(size, terms[0].a->size) + 1);
+        (terms[0].negative ? subtract : sum)(*this, *terms[0].a, *this);
+        return;
+    }
+
+    for (size_t t = 0; t < num_terms; ++t)
+    {
+        if (terms[t].refers_To(*this))
         {
-            // case when the signed sum overloads and we need to store it dynamically
-            HugeInt huge_result(2, 0);
-            huge_result.data.ptr[0] = result;
-            huge_result.data.ptr[1] = this_sign;
-            return huge_result;
+            HugeInt result(0);
+            result.evaluate(terms, num_terms, false);
+            if (accumulate)
+                *this += result;
+            else
+                *this = std::move(result);
+            return;
         }
-        else
-            return HugeInt(result); // case when the signed sum doesn't overload and can be stored statically
     }
-    else
+
+    // wide enough for any of the terms (a negated value may need one integer more), plus one integer for the carries
+    // if there are several of them
+    size_t width = accumulate ? size : 1;
+    for (size_t t = 0; t < num_terms; ++t)
     {
-        // case when at least one of operands is already 'huge' and dynamically stored and then so is the sum of them
-        HugeInt result(std::max(size, arg.size), 1); // 1 int more capacity for overloaded sum
-        copy_and_shift_ContentsTo(result, 0);
-        char carry = sum(result, arg, 0);
+        const HugeIntTerm &term = terms[t];
+        width = std::max(width, term.b ? term.a->size + term.b->size : term.a->size + term.negative);
+    }
+    if (num_terms + accumulate > 1)
+        ++width;
 
-        char this_sign = sign(get_BaseUint(result.size - 1));
-        char arg_sign = sign(arg.get_BaseUint(result.size - 1));
+    // the sum is computed modulo 2^(width * bits), where two's complement values can be added as they are
+    if (!accumulate)
+    {
+        size = 1;
+        get_BaseUints()[0] = 0;
+    }
+    reserve_Capacity(width);
+    BaseUint *r = get_BaseUints();
+
+    // a positive plain first term is the initial value of the sum
+    size_t first_term = 0;
+    if (!accumulate && num_terms > 0 && !terms[0].b && !terms[0].negative)
+    {
+        std::copy(terms[0].a->get_BaseUints(), terms[0].a->get_BaseUints() + terms[0].a->size, r);
+        size = terms[0].a->size;
+        first_term = 1;
+    }
+    BaseUint extension = is_Negative() ? ~BaseUint(0) : 0;
+    std::fill(r + size, r + width, extension);
+
+    for (size_t t = first_term; t < num_terms; ++t)
+    {
+        const HugeIntTerm &term = terms[t];
+        if (!term.b)
+        {
+            // a negative value x is 2^(size * bits) + x in its representation, so the power is subtracted back
+            auto add_Value = term.negative ? limbs::subtract_From : limbs::add_Into;
+            auto subtract_Value = term.negative ? limbs::add_Into : limbs::subtract_From;
+            add_Value(r, width, term.a->get_BaseUints(), term.a->size);
+            if (term.a->is_Negative() && term.a->size < width)
+            {
+                BaseUint one = 1;
+                subtract_Value(r + term.a->size, width - term.a->size, &one, 1);
+            }
+            continue;
+        }
 
-        if (carry && this_sign * arg_sign > 0)
+        HugeInt a_buffer(0), b_buffer(0);
+        size_t a_size, b_size;
+        const BaseUint *a_data = term.a->get_Magnitude(a_buffer, a_size);
+        const BaseUint *b_data = term.b == term.a ? a_data : term.b->get_Magnitude(b_buffer, b_size);
+        if (term.b == term.a)
+            b_size = a_size;
+        if (a_size == 0 || b_size == 0)
+            continue;
+        if (a_size < b_size)
+            std::swap(a_data, b_data), std::swap(a_size, b_size);
+        bool negative = term.negative != (term.a->is_Negative() != term.b->is_Negative());
+        auto add_Product = negative ? limbs::subtract_From : limbs::add_Into;
+
+        if (t == 0 && !accumulate)
         {
-            result.set_BaseUint(result.size, this_sign); // set last integer as a 'sign integer'
-            ++result.size; // the signed sum overloaded, so the size now matches capacity
+            // nothing to add to, typically the only product of the expression
+            limbs::multiply_Limbs(r, a_data, a_size, b_data, b_size);
+            if (negative)
+                limbs::negate_Limbs(r, width);
         }
-        return result;
+        else if (b_size < karatsuba_threshold)
+        {
+            // schoolbook multiplication right into the sum, a row per integer of b
+            auto add_Row = negative ? limbs::subtract_multiplied_by_Limb : limbs::add_multiplied_by_Limb;
+            for (size_t i = 0; i < b_size; ++i)
+            {
+                BaseUint high = add_Row(r + i, a_data, a_size, b_data[i]);
+                add_Product(r + i + a_size, width - i - a_size, &high, 1);
+            }
+        }
+        else
+        {
+            LimbBuffer product(a_size + b_size);
+            limbs::multiply_Limbs(product.data(), a_data, a_size, b_data, b_size);
+            add_Product(r, width, product.data(), a_size + b_size);
+        }
+    }
+
+    size = get_TrimmedSize(r, width);
+}
+
+
+HugeInt& HugeInt::operator+=(const HugeInt &arg)
+{
+    reserve_Capacity(std::max(size, arg.size) + 1);
+    sum(*this, arg, *this);
+    return *this;
+}
+
+
+HugeInt& HugeInt::operator-=(const HugeInt &arg)
+{
+    reserve_Capacity(std::max(size, arg.size) + 1);
+    subtract(*this, arg, *this);
+    return *this;
+}
+
+
+HugeInt& HugeInt::operator*=(const HugeInt &arg)
+{
+    // multiplication can't be done in place, but the product's memory is taken over instead of copied
+    HugeInt result(size + arg.size, 0);
+    multiply(*this, arg, result);
+    *this = std::move(result);
+    return *this;
+}
+
+
+HugeInt& HugeInt::operator/=(const HugeInt &arg)
+{
+    divide(*this, arg, this, nullptr);
+    return *this;
+}
+
+
+HugeInt& HugeInt::operator%=(const HugeInt &arg)
+{
+    divide(*this, arg, nullptr, this);
+    return *this;
+}
+
+
+/**
+ * @brief r = x << shift for the n integers of x. 'r' has room for n + shift / (bits of BaseUint) + 1 integers and may
+ * start at x. Returns the size of r.
+ */
+static size_t shift_Left(HugeInt::BaseUint *r, const HugeInt::BaseUint *x, size_t n, size_t shift)
+{
+    static constexpr size_t base_uint_bits = sizeof(HugeInt::BaseUint) * 8;
+    size_t base_uint_shift = shift / base_uint_bits;
+    unsigned bit_shift = shift % base_uint_bits;
+    HugeInt::BaseUint extension = (x[n - 1] >> (base_uint_bits - 1)) ? ~HugeInt::BaseUint(0) : 0;
+
+    // whole integers and bits are shifted in the same pass, from the top, so r may overlap x
+    HugeInt::BaseUint shifted_out = limbs::shift_Left(r + base_uint_shift, x, n, bit_shift);
+    std::fill(r, r + base_uint_shift, 0);
+    size_t rn = n + base_uint_shift;
+    r[rn] = bit_shift ? (extension << bit_shift) | shifted_out : extension;
+    return get_TrimmedSize(r, rn + 1);
+}
+
+
+/**
+ * @brief r = x >> shift (rounded towards minus infinity) for the n integers of x. 'r' has room for n integers and may
+ * start at x. Returns the size of r.
+ */
+static size_t shift_Right(HugeInt::BaseUint *r, const HugeInt::BaseUint *x, size_t n, size_t shift)
+{
+    static constexpr size_t base_uint_bits = sizeof(HugeInt::BaseUint) * 8;
+    size_t base_uint_shift = shift / base_uint_bits;
+    unsigned bit_shift = shift % base_uint_bits;
+    HugeInt::BaseUint extension = (x[n - 1] >> (base_uint_bits - 1)) ? ~HugeInt::BaseUint(0) : 0;
+
+    if (base_uint_shift >= n)
+    {
+        r[0] = extension;
+        return 1;
     }
+    size_t rn = n - base_uint_shift;
+    limbs::shift_Right(r, x + base_uint_shift, rn, bit_shift);
+    if (bit_shift)
+        r[rn - 1] |= extension << (base_uint_bits - bit_shift);
+    return get_TrimmedSize(r, rn);
+}
+
+
+/**
+ * @brief r = a op b, for a commutative bitwise operation, with the shorter of a and b sign extended. 'r' has room for
+ * the longer one and may be either of them. Returns the size of r.
+ */
+template <typename Operation>
+static size_t combine_Bits(HugeInt::BaseUint *r, const HugeInt::BaseUint *a, size_t an,
+                           const HugeInt::BaseUint *b, size_t bn, Operation operation)
+{
+    static constexpr size_t base_uint_bits = sizeof(HugeInt::BaseUint) * 8;
+    if (an < bn)
+    {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    HugeInt::BaseUint b_extension = (b[bn - 1] >> (base_uint_bits - 1)) ? ~HugeInt::BaseUint(0) : 0;
+
+    for (size_t i = 0; i < bn; ++i)
+        r[i] = operation(a[i], b[i]);
+    for (size_t i = bn; i < an; ++i)
+        r[i] = operation(a[i], b_extension);
+    return get_TrimmedSize(r, an);
+}
+
+
+HugeInt& HugeInt::operator<<=(size_t shift)
+{
+    reserve_Capacity(size + shift / (sizeof(BaseUint) * 8) + 1);
+    BaseUint *data = get_BaseUints();
+    size = shift_Left(data, data, size, shift);
+    return *this;
+}
+
+
+HugeInt& HugeInt::operator>>=(size_t shift)
+{
+    BaseUint *data = get_BaseUints();
+    size = shift_Right(data, data, size, shift);
+    return *this;
+}
+
+
+HugeInt& HugeInt::operator&=(const HugeInt &arg)
+{
+    reserve_Capacity(arg.size);
+    size = combine_Bits(get_BaseUints(), get_BaseUints(), size,
+                        arg.get_BaseUints(), arg.size, std::bit_and<BaseUint>());
+    return *this;
+}
+
+
+HugeInt& HugeInt::operator|=(const HugeInt &arg)
+{
+    reserve_Capacity(arg.size);
+    size = combine_Bits(get_BaseUints(), get_BaseUints(), size,
+                        arg.get_BaseUints(), arg.size, std::bit_or<BaseUint>());
+    return *this;
 }
 
 
-HugeInt HugeInt::operator*(const HugeInt &arg) const
+HugeInt& HugeInt::operator^=(const HugeInt &arg)
 {
-    size_t size = get_TechnicalSize();
-    size_t arg_size = arg.get_TechnicalSize();
-    HugeInt result(size + arg_size, 0);
-    HugeInt product_by_int(result.size, 0);
+    reserve_Capacity(arg.size);
+    size = combine_Bits(get_BaseUints(), get_BaseUints(), size,
+                        arg.get_BaseUints(), arg.size, std::bit_xor<BaseUint>());
+    return *this;
+}
 
-    multiply(*this, arg, result, product_by_int);
 
+HugeInt HugeInt::operator<<(size_t shift) const
+{
+    HugeInt result = make_Uninitialized(size + shift / (sizeof(BaseUint) * 8) + 1);
+    result.size = shift_Left(result.get_BaseUints(), get_BaseUints(), size, shift);
+    return result;
+}
+
+
+HugeInt HugeInt::operator>>(size_t shift) const
+{
+    HugeInt result = make_Uninitialized(size);
+    result.size = shift_Right(result.get_BaseUints(), get_BaseUints(), size, shift);
     return result;
 }
 
 
-std::string HugeInt::to_String() const
+HugeInt HugeInt::operator&(const HugeInt &arg) const
 {
-    std::stringstream ss;
-    ss << "0x" << std::hex;
-    for (size_t i = get_TechnicalSize() - 1; i >= 0; --i)
+    HugeInt result = make_Uninitialized(std::max(size, arg.size));
+    result.size = combine_Bits(result.get_BaseUints(), get_BaseUints(), size,
+                               arg.get_BaseUints(), arg.size, std::bit_and<BaseUint>());
+    return result;
+}
+
+
+HugeInt HugeInt::operator|(const HugeInt &arg) const
+{
+    HugeInt result = make_Uninitialized(std::max(size, arg.size));
+    result.size = combine_Bits(result.get_BaseUints(), get_BaseUints(), size,
+                               arg.get_BaseUints(), arg.size, std::bit_or<BaseUint>());
+    return result;
+}
+
+
+HugeInt HugeInt::operator^(const HugeInt &arg) const
+{
+    HugeInt result = make_Uninitialized(std::max(size, arg.size));
+    result.size = combine_Bits(result.get_BaseUints(), get_BaseUints(), size,
+                               arg.get_BaseUints(), arg.size, std::bit_xor<BaseUint>());
+    return result;
+}
+
+
+HugeInt HugeInt::operator~() const
+{
+    HugeInt result = make_Uninitialized(size);
+    const BaseUint *data = get_BaseUints();
+    BaseUint *result_data = result.get_BaseUints();
+    for (size_t i = 0; i < size; ++i)
+        result_data[i] = ~data[i];
+    return result;
+}
+
+
+size_t HugeInt::get_BitLength() const
+{
+    static constexpr size_t base_uint_bits = sizeof(BaseUint) * 8;
+    const BaseUint *data = get_BaseUints();
+    BaseUint extension = is_Negative() ? ~BaseUint(0) : 0;
+
+    // bits that differ from the sign, those of x or of ~x = |x| - 1 for negative x
+    size_t n = size;
+    while (n > 0 && data[n - 1] == extension)
+        --n;
+    if (n == 0)
+        return is_Negative();
+    size_t bit_length = n * base_uint_bits - limbs::count_LeadingZeros(data[n - 1] ^ extension);
+
+    // |x| = ~x + 1 is one bit longer if ~x is all ones, that is when x = -2^bit_length
+    if (is_Negative())
     {
-        ss << get_BaseUint(i);
-        ss << std::setfill('0') << std::setw(sizeof(BaseUint) * 2);
-        if (i == 0)
-            break;
+        size_t i = 0;
+        while (data[i] == 0)
+            ++i;
+        if (i * base_uint_bits + limbs::count_TrailingZeros(data[i]) == bit_length)
+            ++bit_length;
     }
-    return ss.str();
+    return bit_length;
+}
+
+
+size_t HugeInt::get_PopCount() const
+{
+    static constexpr size_t base_uint_bits = sizeof(BaseUint) * 8;
+    const BaseUint *data = get_BaseUints();
+    if (!is_Negative())
+        return limbs::count_SetBits(data, size);
+
+    // -x has the same lowest set bit and zeros below it as x, and the inverted bits above (zeros in place of the sign
+    // extension), no need to negate it
+    size_t i = 0;
+    while (data[i] == 0)
+        ++i;
+    BaseUint up_to_lowest_set = data[i] ^ (data[i] - 1);
+    BaseUint inverted_above = ~data[i] & ~up_to_lowest_set;
+    size_t num_above = size - i - 1;
+    return 1 + limbs::count_SetBits(&inverted_above, 1) + num_above * base_uint_bits -
+           limbs::count_SetBits(data + i + 1, num_above);
+}
+
+
+int HugeInt::compare(const HugeInt &a, const HugeInt &b)
+{
+    bool a_negative = a.is_Negative();
+    if (a_negative != b.is_Negative())
+        return a_negative ? -1 : 1;
+    // both are of the fewest integers, so the longer one is further from zero
+    if (a.size != b.size)
+        return (a.size > b.size) != a_negative ? 1 : -1;
+    // of the same sign and size two's complement arrays compare as unsigned ones
+    return limbs::compare_Limbs(a.get_BaseUints(), b.get_BaseUints(), a.size);
+}
+
+
+size_t HugeInt::get_Hash() const
+{
+    // the representation is unique, so hashing its bytes is enough
+    std::string_view bytes(reinterpret_cast<const char *>(get_BaseUints()), size * sizeof(BaseUint));
+    return std::hash<std::string_view>()(bytes);
+}
+
+
+HugeInt HugeInt::square() const
+{
+    HugeInt result(2 * size, 0);
+    multiply(*this, *this, result);
+    return result;
+}
+
+
+HugeInt HugeInt::operator/(const HugeInt &arg) const
+{
+    HugeInt quotient(0);
+    divide(*this, arg, &quotient, nullptr);
+    return quotient;
+}
+
+
+HugeInt HugeInt::operator%(const HugeInt &arg) const
+{
+    HugeInt remainder(0);
+    divide(*this, arg, nullptr, &remainder);
+    return remainder;
+}
+
+
+void HugeInt::divmod(const HugeInt &dividend, const HugeInt &divisor, HugeInt &quotient, HugeInt &remainder)
+{
+    divide(dividend, divisor, &quotient, &remainder);
+}
+
+
+HugeInt HugeInt::pow_mod(const HugeInt &base, const HugeInt &exponent, const HugeInt &modulus)
+{
+    if (!modulus.is_Negative() && (modulus.get_BaseUint(0) & 1))
+        return MontgomeryContext(modulus).pow_Mod(base, exponent);
+
+    HugeInt modulus_buffer(0), exponent_buffer(0);
+    size_t modulus_size, exponent_size;
+    modulus.get_Magnitude(modulus_buffer, modulus_size);
+    if (modulus.is_Negative() || modulus_size == 0)
+        throw std::domain_error("Modulus of the modular power must be positive.");
+    if (exponent.is_Negative())
+        throw std::domain_error("Exponent of the modular power must not be negative.");
+    const BaseUint *e = exponent.get_Magnitude(exponent_buffer, exponent_size);
+
+    // Montgomery reduction needs an odd modulus, so even ones get plain right to left binary exponentiation
+    static constexpr size_t base_uint_bits = sizeof(BaseUint) * 8;
+    HugeInt result = HugeInt(1) % modulus;
+    HugeInt power = base % modulus;
+    if (power.is_Negative())
+        power += modulus;
+    for (size_t i = 0, n = exponent.get_BitLength(); i < n; ++i)
+    {
+        if ((e[i / base_uint_bits] >> (i % base_uint_bits)) & 1)
+            (result *= power) %= modulus;
+        (power *= power) %= modulus;
+    }
+    return result;
+}
+
+
+std::string HugeInt::to_String(int base) const
+{
+    const BaseUint *data = get_BaseUints();
+    std::string result;
+
+    if (base == 16)
+    {
+        // two's complement representation as is, the most significant integer is not zero padded
+        static constexpr char hex_digits[] = "0123456789abcdef";
+        static constexpr size_t digits_per_base_uint = sizeof(BaseUint) * 2;
+
+        BaseUint top = data[size - 1];
+        size_t top_digits = 1;
+        while (top_digits < digits_per_base_uint && (top >> (4 * top_digits)))
+            ++top_digits;
+
+        result.resize(2 + top_digits + (size - 1) * digits_per_base_uint);
+        char *out = &result[0];
+        *out++ = '0';
+        *out++ = 'x';
+        for (size_t i = size; i-- > 0;)
+        {
+            BaseUint x = data[i];
+            size_t num_digits = i == size - 1 ? top_digits : digits_per_base_uint;
+            for (size_t d = num_digits; d-- > 0;)
+            {
+                out[d] = hex_digits[x & 0xf];
+                x >>= 4;
+            }
+            out += num_digits;
+        }
+    }
+    else if (base == 10)
+    {
+        HugeInt buffer(0);
+        size_t magnitude_size;
+        const BaseUint *magnitude = get_Magnitude(buffer, magnitude_size);
+        if (is_Negative())
+            result += '-';
+        limbs::format_Decimal(result, magnitude, magnitude_size);
+    }
+    else
+        throw std::invalid_argument("HugeInt can only be converted to a string in base 10 or 16.");
+
+    return result;
 }
 
 
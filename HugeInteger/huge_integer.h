@@ -5,29 +5,97 @@
 #include <string>
 #include <cstdint>
 #include <ostream>
+#include <istream>
+#include <functional>
+
+
+// Size of base integers of HugeInt in bits - 32 or 64. Can be selected at compile time, by default the widest one
+// supported is used. 64-bit base integers require unsigned __int128 for the double base type.
+#ifndef HUGE_INT_BASE_BITS
+#ifdef __SIZEOF_INT128__
+#define HUGE_INT_BASE_BITS 64
+#else
+#define HUGE_INT_BASE_BITS 32
+#endif
+#endif
+
+
+// Number of base integers HugeInt stores in place, without allocating memory. Can be selected at compile time.
+#ifndef HUGE_INT_INLINE_CAPACITY
+#define HUGE_INT_INLINE_CAPACITY 4
+#endif
+
+
+class LimbAllocator;
+class MontgomeryContext;
+class HugeIntView;
+struct HugeIntTerm;
+template <size_t num_terms>
+class HugeIntExpression;
+template <size_t bits>
+class FixedHugeInt;
+
+
+// Base integer types of HugeInt by their size in bits.
+template <unsigned bits>
+struct HugeIntBaseTypes;
+
+template <>
+struct HugeIntBaseTypes<32>
+{
+    using BaseInt = int32_t;
+    using BaseUint = uint32_t;
+    using DoubleBaseUint = uint64_t;
+};
+
+#ifdef __SIZEOF_INT128__
+template <>
+struct HugeIntBaseTypes<64>
+{
+    using BaseInt = int64_t;
+    using BaseUint = uint64_t;
+    using DoubleBaseUint = unsigned __int128;
+};
+#endif
 
 
 
 class HugeInt
 {
+    friend class MontgomeryContext;
+    friend class HugeIntView;
+    template <size_t bits>
+    friend class FixedHugeInt;
+
 public:
     // Signed integer type
-    using BaseInt = int32_t;
+    using BaseInt = HugeIntBaseTypes<HUGE_INT_BASE_BITS>::BaseInt;
     // Unsigned integer type. Representation of huge int is either an array of unsigned integers or just a single unsigned integer.
-    using BaseUint = uint32_t;
+    using BaseUint = HugeIntBaseTypes<HUGE_INT_BASE_BITS>::BaseUint;
     // Double base unsigned integer type. Used to handle multiplication overloads.
-    using DoubleBaseUint = uint64_t;
+    using DoubleBaseUint = HugeIntBaseTypes<HUGE_INT_BASE_BITS>::DoubleBaseUint;
+
+public:
+    // Number of base integers stored right inside HugeInt, so that values up to this size never allocate memory.
+    static constexpr size_t INLINE_CAPACITY = HUGE_INT_INLINE_CAPACITY;
+    static_assert(INLINE_CAPACITY > 0, "HugeInt has to store at least one integer in place.");
 
 private:
-    // Union to hold pointer to array of integers or a static single integer in order to reduce memory allocations.
+    // Union to hold pointer to array of integers or a few integers in place in order to reduce memory allocations.
     union Data
     {
-        BaseUint *ptr; // Pointer to array of integers if the size > 0. Last bit of the last element is a sign bit.
-        // (using unsigned integers is actually easier)
-        BaseUint static_val; // Single integer if the size == 0 (technically is 1). Last bit of it is a sign bit actually.
+        struct
+        {
+            BaseUint *ptr; // Pointer to array of integers if capacity > INLINE_CAPACITY
+            LimbAllocator *allocator; // and the allocator it came from.
+        } heap;
+        BaseUint inline_vals[INLINE_CAPACITY]; // Integers stored in place otherwise.
     } data;
-    // Size of the array of integers. Equals to zero if there's only static single integer.
+    // Number of integers in use, never less than 1. Last bit of the last one is a sign bit (using unsigned integers is actually easier).
+    // Always the fewest integers that hold the value (see normalize), so equal values have equal representations.
     size_t size;
+    // Number of integers there is memory for. Equals to INLINE_CAPACITY if they're stored in place.
+    size_t capacity;
 
     /**
      * @brief Private constructor to manually manage memory.
@@ -42,91 +110,170 @@ private:
     HugeInt(size_t size, size_t additional_capacity);
 
     /**
-     * @brief Get i-th element from the array representation or just single integer if size == 0, i == 0.
+     * @brief Make sure there's memory for at least 'min_capacity' integers. Grows the capacity geometrically (at least doubles
+     * it), so that a long sequence of growing in-place operations reallocates only a logarithmic number of times.
+     */
+    void reserve_Capacity(size_t min_capacity);
+    /**
+     * @brief Move to newly allocated memory for 'new_capacity' > INLINE_CAPACITY integers from the current allocator
+     * (see limb_allocator.h), keeping the first 'num_kept' integers.
+     */
+    void reallocate(size_t new_capacity, size_t num_kept);
+    /**
+     * @brief Give the allocated memory, if any, back to its allocator. Leaves the data as is.
+     */
+    void free_Memory();
+    /**
+     * @brief HugeInt of 'size' integers with their values left undefined, for results that overwrite all of them anyway.
+     */
+    static HugeInt make_Uninitialized(size_t size);
+    /**
+     * @brief Drop the leading integers that are just sign extensions of the rest. Every operation leaves its result
+     * this way, comparison and hashing rely on it.
+     */
+    void normalize();
+
+    /**
+     * @brief Whether the integers are stored in place rather than in allocated memory.
+     */
+    inline bool is_Inline() const
+    {
+        return capacity <= INLINE_CAPACITY;
+    }
+
+    /**
+     * @brief Get i-th element of the representation or 0 if i >= size.
      * Basically - (BaseUint)(huge_int >> ((sizeof(BaseUint) * i))).
      */
     inline BaseUint get_BaseUint(size_t i) const
     {
-        if (size > 0)
-        {
-            if (i < size)
-                return data.ptr[i];
-            else return 0;
-        }
-        else if (i == 0)
-            return data.static_val;
-        else return 0;
+        return i < size ? get_BaseUints()[i] : 0;
     }
 
     /**
-     * @brief Set i-th element from the array representation or just single integer if size == 0, i == 0.
+     * @brief Set i-th element of the representation if i < size.
      */
     inline void set_BaseUint(size_t i, BaseUint base_int)
     {
-        if (size > 0)
-        {
-            if (i < size)
-                data.ptr[i] = base_int;
-        }
-        else if (i == 0)
-            data.static_val = base_int;
+        if (i < size)
+            get_BaseUints()[i] = base_int;
     }
 
     /**
-     * @brief If size == 0, it just means that we're using data.static_val but techincally size is 1 in this case.
-     * @note There can be a case when size and technical size == 1 and the data is stored in dynamic array of just single element.
-     * However, in that case 'techincally' we don't care.
+     * @brief Pointer to the array representation, either in place or allocated.
      */
-    inline size_t get_TechnicalSize() const
+    inline BaseUint *get_BaseUints()
     {
-        if (size > 0)
-            return size;
-        else
-            return 1;
+        return is_Inline() ? data.inline_vals : data.heap.ptr;
     }
 
-    /**
-     * @brief Clear, make zero.
-     */
-    inline void clear()
+    inline const BaseUint *get_BaseUints() const
     {
-        if (size > 0)
-            std::fill(data.ptr, data.ptr + size, 0);
-        else
-            data.static_val = 0;
+        return is_Inline() ? data.inline_vals : data.heap.ptr;
     }
 
     /**
-     * @brief Copy and shift contents of this to another huge integer, without changing its size.
+     * @brief Check the sign bit of the last element.
      */
-    inline void copy_and_shift_ContentsTo(HugeInt &other, size_t shift) const
+    inline bool is_Negative() const
     {
-        if (size > 0)
-            std::copy(data.ptr, data.ptr + size, other.data.ptr + shift);
-        else if (other.size > 0)
-            other.data.ptr[shift] = data.static_val;
-        else
-            other.data.static_val = shift > 0 ? 0 : data.static_val;
+        return get_BaseUint(size - 1) >> (sizeof(BaseUint) * 8 - 1);
     }
+
+    /**
+     * @brief Absolute value as an unsigned array of base integers without leading zeros.
+     * Points either to the contents of this or, if it's negative, to its negated copy stored in 'buffer'.
+     */
+    const BaseUint *get_Magnitude(HugeInt &buffer, size_t &magnitude_size) const;
+
     /**
-     * @brief Add 'b' to 'a' with a carry. Assuming 'a' is long enough to not overload. Returns a new carry.
+     * @brief Add 'a' and 'b' and store in 'c'. Assuming 'c' has capacity for one integer more than the longest of 'a' and 'b'.
+     * 'c' may be the same object as 'a' or 'b'. Size of 'c' is set to fit the sum.
      */
-    static char sum(HugeInt &a, const HugeInt &b, char carry = 0);
+    static void sum(const HugeInt &a, const HugeInt &b, HugeInt &c);
     /**
-     * @brief Multiply 'a' and 'b' and store in 'c' using a temporary variable of the same size. Assuming all of them are
-     * long enough to not overload.
+     * @brief Subtract 'b' from 'a' and store in 'c'. Same assumptions as for the sum.
      */
-    static void multiply(const HugeInt &a, const HugeInt &b, HugeInt &c, HugeInt &temp_var);
+    static void subtract(const HugeInt &a, const HugeInt &b, HugeInt &c);
     /**
-     * @brief Multiply a huge int by a base int. Assuming 'a' is long enough to handle overloads.
+     * @brief Multiply 'a' and 'b' and store in 'c'. Assuming 'c' is at least as long as 'a' and 'b' together,
+     * its size is then set to fit the product.
+     * Picks schoolbook, Karatsuba, Toom-3 or NTT algorithm by the size of operands (see the thresholds below).
+     * Squares if 'a' and 'b' are the same object.
      */
-    static void multiply_by_BaseUint(HugeInt &a, BaseUint b);
+    static void multiply(const HugeInt &a, const HugeInt &b, HugeInt &c);
+    /**
+     * @brief Divide 'a' by 'b' rounding towards zero, store the quotient in 'q' and the remainder (of the sign of 'a')
+     * in 'r' unless they're null. Either may be the same object as 'a' or 'b'. Throws std::domain_error if 'b' is zero.
+     */
+    static void divide(const HugeInt &a, const HugeInt &b, HugeInt *q, HugeInt *r);
+    /**
+     * @brief Set this to the sum of the terms or, if 'accumulate', add the sum to this. The sum is accumulated in the
+     * memory of this, one integer wider than the widest term for the carries, with schoolbook sized products added
+     * row by row and the rest multiplied into a scratch buffer first. Terms may refer to this.
+     */
+    void evaluate(const HugeIntTerm *terms, size_t num_terms, bool accumulate);
+
+    // Matrix of a reduction of a pair of positive integers by the steps of the Euclidean algorithm (number_theory.cpp).
+    struct ReductionMatrix;
+    /**
+     * @brief One step of the Euclidean algorithm that keeps 'a' and 'b' above 'bound': the larger one is reduced by
+     * the largest multiple of the smaller one that does. Returns false if there's no such step. The step is appended
+     * to 'm' unless it's null.
+     */
+    static bool reduce_Step(HugeInt &a, HugeInt &b, const HugeInt &bound, ReductionMatrix *m);
+    /**
+     * @brief Reduce 'a' and 'b', both above 2^threshold, as far as they stay above it, by Lehmer steps: the leading
+     * bits are reduced in double base integers, the matrix of that is applied to the whole numbers. Returns false if
+     * nothing was reduced.
+     */
+    static bool reduce_Lehmer(HugeInt &a, HugeInt &b, size_t threshold, ReductionMatrix *m);
+    /**
+     * @brief Reduce 'a' and 'b' by the matrix that reduces their bits above 'position' by half (see reduce_HalfGCD).
+     * Returns false if nothing was reduced.
+     */
+    static bool reduce_Top(HugeInt &a, HugeInt &b, size_t position, ReductionMatrix *m);
+    /**
+     * @brief Same as reduce_Lehmer, but large numbers are reduced recursively by their leading bits, two times by
+     * half of the bits above the threshold. Returns false if nothing was reduced.
+     */
+    static bool reduce_HalfGCD(HugeInt &a, HugeInt &b, size_t threshold, ReductionMatrix *m);
+    /**
+     * @brief Reduce non-negative 'a' and 'b' until one of them is 0, the other one is then their gcd.
+     */
+    static void reduce_Euclid(HugeInt &a, HugeInt &b, ReductionMatrix *m);
 
 public:
+    // Operand size (in base integers) starting from which multiplication switches from schoolbook to Karatsuba algorithm.
+    static size_t karatsuba_threshold;
+    // Operand size (in base integers) starting from which squaring switches from schoolbook to Karatsuba algorithm.
+    // Later than for multiplication, as schoolbook squaring needs only half of the products. The Toom-3 and NTT
+    // thresholds are shared.
+    static size_t karatsuba_square_threshold;
+    // Operand size (in base integers) starting from which multiplication switches from Karatsuba to Toom-3 algorithm.
+    static size_t toom3_threshold;
+    // Operand size (in base integers) starting from which multiplication uses number theoretic transform (if the product
+    // is not too large for it, otherwise it keeps splitting operands by Toom-3 until the parts fit).
+    static size_t ntt_threshold;
+    // Number of threads a single multiplication may use (the calling one included). 1, the default, keeps everything
+    // on the calling thread. Applies to everything built on multiplication: squaring, division, radix conversion.
+    static size_t multiplication_threads;
+    // Operand size (in base integers) starting from which the parts of a multiplication are computed in parallel
+    // (the products of Karatsuba and Toom-3 recursion levels, the convolutions and butterflies of NTT).
+    static size_t parallel_threshold;
+    // Divisor and quotient size (in base integers) starting from which division switches from schoolbook to
+    // Burnikel-Ziegler recursive algorithm (at least 2).
+    static size_t burnikel_ziegler_threshold;
+    // Operand size (in base integers) starting from which gcd and mod_inverse halve the operands recursively (half-GCD)
+    // instead of by Lehmer steps.
+    static size_t half_gcd_threshold;
+
     // Initialize from base integer.
     HugeInt(BaseInt value);
     // Initialize from string
     HugeInt(std::string value);
+    // Initialize from little-endian array of base integers in two's complement (last bit of the last element is a sign bit).
+    HugeInt(const BaseUint *base_uints, size_t count);
 
     // HugeInt stores (may store) a resource, so the big 5 rule
     HugeInt(const HugeInt &other);
@@ -135,16 +282,142 @@ public:
     HugeInt& operator=(HugeInt &&rhs) noexcept;
     ~HugeInt();
 
+    // +, - and * make a lazy HugeIntExpression (see huge_integer_expression.h) that's computed all at once here.
+    template <size_t num_terms>
+    HugeInt(const HugeIntExpression<num_terms> &expression);
+    template <size_t num_terms>
+    HugeInt& operator=(const HugeIntExpression<num_terms> &expression);
+    template <size_t num_terms>
+    HugeInt& operator+=(const HugeIntExpression<num_terms> &expression);
+    template <size_t num_terms>
+    HugeInt& operator-=(const HugeIntExpression<num_terms> &expression);
+
+
+    // Same as x * x, which is also recognized in expressions, but takes about half of the time of a multiplication.
+    HugeInt square() const;
+    // Division rounds towards zero and the remainder has the sign of the dividend, as for built-in integers.
+    // Both throw std::domain_error on division by zero.
+    HugeInt operator/(const HugeInt &arg) const;
+    HugeInt operator%(const HugeInt &arg) const;
+
+    // Quotient and remainder of one division, cheaper than computing them separately.
+    static void divmod(const HugeInt &dividend, const HugeInt &divisor, HugeInt &quotient, HugeInt &remainder);
+    // base^exponent mod modulus in [0, modulus). The modulus must be positive and the exponent non-negative, otherwise
+    // std::domain_error is thrown. Odd moduli go through Montgomery multiplication; use MontgomeryContext (montgomery.h)
+    // directly to reuse the precomputations for many exponentiations by the same modulus.
+    static HugeInt pow_mod(const HugeInt &base, const HugeInt &exponent, const HugeInt &modulus);
+    // Greatest common divisor of the absolute values, 0 only if both are 0.
+    static HugeInt gcd(const HugeInt &a, const HugeInt &b);
+    // x in [0, modulus) such that a * x = 1 mod modulus. Throws std::domain_error if the modulus is not positive or
+    // 'a' is not coprime to it.
+    static HugeInt mod_inverse(const HugeInt &a, const HugeInt &modulus);
+    // floor(sqrt(x)), throws std::domain_error if x is negative.
+    static HugeInt isqrt(const HugeInt &x);
+    // n-th root rounded towards zero. Throws std::domain_error if n is 0, or even and x is negative.
+    static HugeInt iroot(const HugeInt &x, unsigned n);
+
+    // In-place versions reuse the memory of this whenever it's large enough.
+    HugeInt& operator+=(const HugeInt &arg);
+    HugeInt& operator-=(const HugeInt &arg);
+    HugeInt& operator*=(const HugeInt &arg);
+    HugeInt& operator/=(const HugeInt &arg);
+    HugeInt& operator%=(const HugeInt &arg);
+    HugeInt& operator<<=(size_t shift);
+    HugeInt& operator>>=(size_t shift);
+    HugeInt& operator&=(const HugeInt &arg);
+    HugeInt& operator|=(const HugeInt &arg);
+    HugeInt& operator^=(const HugeInt &arg);
+
+    // Shifts move the representation by whole integers and bits in a single pass, no multiplication or division
+    // involved. The right shift is arithmetic: negative values are rounded towards minus infinity, as by floor division
+    // by 2^shift.
+    HugeInt operator<<(size_t shift) const;
+    HugeInt operator>>(size_t shift) const;
+    // Bitwise operations act on the infinite two's complement representations, the shorter operand is sign extended.
+    // ~x is -x - 1.
+    HugeInt operator&(const HugeInt &arg) const;
+    HugeInt operator|(const HugeInt &arg) const;
+    HugeInt operator^(const HugeInt &arg) const;
+    HugeInt operator~() const;
+
+    // -1, 0 or 1 if 'a' is less than, equal to or greater than 'b'. Values of different signs or sizes are told apart
+    // without looking at their integers. The comparison operators below are built on it.
+    static int compare(const HugeInt &a, const HugeInt &b);
+    // Hash of the value for std::hash, equal values have equal hashes.
+    size_t get_Hash() const;
+
+    // Number of bits of the absolute value, 0 for 0 (as int.bit_length in Python).
+    size_t get_BitLength() const;
+    // Number of ones in the binary representation of the absolute value (as int.bit_count in Python).
+    size_t get_PopCount() const;
+
+
+    // Convert to a string in base 10 (signed) or 16 (two's complement, prefixed with 0x).
+    std::string to_String(int base = 16) const;
+
+    // Write in the binary format of serialization.h: a 16 byte header and the base integers as they are in memory.
+    void serialize(std::ostream &os) const;
+    // Read a value written by serialize, by a build with either base integer size. Throws std::invalid_argument if
+    // the stream doesn't continue with a serialized HugeInt.
+    static HugeInt deserialize(std::istream &is);
+};
+
+
+inline bool operator==(const HugeInt &a, const HugeInt &b)
+{
+    return HugeInt::compare(a, b) == 0;
+}
+
+
+inline bool operator!=(const HugeInt &a, const HugeInt &b)
+{
+    return HugeInt::compare(a, b) != 0;
+}
+
+
+inline bool operator<(const HugeInt &a, const HugeInt &b)
+{
+    return HugeInt::compare(a, b) < 0;
+}
+
+
+inline bool operator<=(const HugeInt &a, const HugeInt &b)
+{
+    return HugeInt::compare(a, b) <= 0;
+}
 
-    HugeInt operator+(const HugeInt &arg) const;
-    HugeInt operator*(const HugeInt &arg) const;
 
+inline bool operator>(const HugeInt &a, const HugeInt &b)
+{
+    return HugeInt::compare(a, b) > 0;
+}
+
+
+inline bool operator>=(const HugeInt &a, const HugeInt &b)
+{
+    return HugeInt::compare(a, b) >= 0;
+}
+
+
+namespace std
+{
 
-    std::string to_String() const;
+template <>
+struct hash<HugeInt>
+{
+    size_t operator()(const HugeInt &x) const
+    {
+        return x.get_Hash();
+    }
 };
 
+}
+
 
 std::ostream& operator<<(std::ostream &os, const HugeInt &x);
 
 
+#include "huge_integer_expression.h"
+
+
 #endif
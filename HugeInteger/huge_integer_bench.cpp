@@ -0,0 +1,476 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <ctime>
+#include <random>
+#include <vector>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <functional>
+#include <new>
+
+
+#include "huge_integer.h"
+#include "limb_allocator.h"
+#include "fixed_huge_integer.h"
+
+
+
+// All allocations of the program go through here, so that the benchmark can tell how many of them an operation does
+static size_t allocation_count = 0;
+
+void *operator new(size_t size)
+{
+    ++allocation_count;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+
+static HugeInt make_RandomHugeInt(size_t size, std::mt19937_64 &rng)
+{
+    std::vector<HugeInt::BaseUint> base_uints(size);
+    for (auto &x : base_uints)
+        x = HugeInt::BaseUint(rng());
+    // keep it positive
+    base_uints.back() &= std::numeric_limits<HugeInt::BaseInt>::max();
+    return HugeInt(base_uints.data(), size);
+}
+
+
+/**
+ * @brief Average time in microseconds of multiplying two random huge integers of the given size.
+ */
+static double measure_Multiplication(size_t size, std::mt19937_64 &rng)
+{
+    HugeInt a = make_RandomHugeInt(size, rng);
+    HugeInt b = make_RandomHugeInt(size, rng);
+
+    using clock = std::chrono::steady_clock;
+    size_t iterations = 0;
+    auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+    do
+    {
+        HugeInt c = a * b;
+        ++iterations;
+        elapsed = clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(200));
+
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+
+/**
+ * @brief Average number of allocations per operation on random huge integers of the given size.
+ */
+template <typename Operation>
+static double count_Allocations(size_t size, std::mt19937_64 &rng, Operation operation)
+{
+    static constexpr size_t iterations = 1000;
+    HugeInt a = make_RandomHugeInt(size, rng);
+    HugeInt b = make_RandomHugeInt(size, rng);
+
+    size_t initial_count = allocation_count;
+    for (size_t i = 0; i < iterations; ++i)
+        operation(a, b);
+    return double(allocation_count - initial_count) / iterations;
+}
+
+
+static void report_SmallValueAllocations(std::mt19937_64 &rng)
+{
+    std::cout << "INLINE_CAPACITY = " << HugeInt::INLINE_CAPACITY << "\n\n";
+    std::cout << std::setw(10) << "limbs"
+              << std::setw(18) << "copy, allocs"
+              << std::setw(18) << "a + b, allocs"
+              << std::setw(18) << "a * b, allocs"
+              << std::setw(22) << "a * b + a * a, allocs" << '\n';
+
+    for (size_t size = 1; size <= 2 * HugeInt::INLINE_CAPACITY; ++size)
+    {
+        std::cout << std::setw(10) << size
+                  << std::setw(18) << count_Allocations(size, rng, [](auto &a, auto &) { HugeInt c = a; })
+                  << std::setw(18) << count_Allocations(size, rng, [](auto &a, auto &b) { HugeInt c = a + b; })
+                  << std::setw(18) << count_Allocations(size, rng, [](auto &a, auto &b) { HugeInt c = a * b; })
+                  << std::setw(22) << count_Allocations(size, rng, [](auto &a, auto &b) { HugeInt c = a * b + a * a; })
+                  << '\n';
+    }
+    std::cout << '\n';
+}
+
+
+/**
+ * @brief Allocations done by summing up a million of terms with 'a = a + b' and with 'a += b'.
+ */
+static void report_AccumulationAllocations(std::mt19937_64 &rng)
+{
+    static constexpr size_t num_terms = 1000000;
+    std::cout << std::setw(10) << "limbs"
+              << std::setw(18) << "a = a + b, allocs"
+              << std::setw(18) << "a += b, allocs" << '\n';
+
+    for (size_t size : {1, 8, 64})
+    {
+        HugeInt term = make_RandomHugeInt(size, rng);
+        HugeInt a(0), b(0);
+
+        size_t initial_count = allocation_count;
+        for (size_t i = 0; i < num_terms; ++i)
+            a = a + term;
+        size_t plus_count = allocation_count - initial_count;
+
+        initial_count = allocation_count;
+        for (size_t i = 0; i < num_terms; ++i)
+            b += term;
+        size_t plus_assign_count = allocation_count - initial_count;
+
+        std::cout << std::setw(10) << size
+                  << std::setw(18) << plus_count
+                  << std::setw(18) << plus_assign_count << '\n';
+    }
+    std::cout << '\n';
+}
+
+
+/**
+ * @brief Allocations and time per 'a * b' done with the heap, arena and pool limb allocators.
+ */
+static void report_AllocatorComparison(std::mt19937_64 &rng)
+{
+    static constexpr size_t iterations = 10000;
+    std::cout << std::setw(10) << "limbs";
+    for (const char *name : {"heap", "arena", "pool"})
+        std::cout << std::setw(12) << name << ", allocs" << std::setw(10) << name << ", us";
+    std::cout << '\n';
+
+    for (size_t size : {8, 64, 512})
+    {
+        HugeInt a = make_RandomHugeInt(size, rng);
+        HugeInt b = make_RandomHugeInt(size, rng);
+        ArenaLimbAllocator arena;
+        PoolLimbAllocator pool;
+        LimbAllocator *allocators[] = {&HeapLimbAllocator::get_Instance(), &arena, &pool};
+
+        std::cout << std::setw(10) << size;
+        for (LimbAllocator *allocator : allocators)
+        {
+            ScopedLimbAllocator scope(*allocator);
+            using clock = std::chrono::steady_clock;
+            size_t initial_count = allocation_count;
+            auto start = clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                {
+                    HugeInt c = a * b;
+                }
+                if (allocator == &arena)
+                    arena.release();
+            }
+            auto elapsed = clock::now() - start;
+
+            std::cout << std::setw(20) << double(allocation_count - initial_count) / iterations
+                      << std::setw(14) << std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+        }
+        std::cout << '\n';
+    }
+    std::cout << '\n';
+}
+
+
+/**
+ * @brief Allocations and time per modular multiplication 'x = x * y % m' of 'bits' wide values, done by HugeInt and by
+ * FixedHugeInt twice as wide, to fit the product.
+ */
+template <size_t bits>
+static void report_FixedWidthRow(std::mt19937_64 &rng)
+{
+    static constexpr size_t iterations = 100000;
+    static constexpr size_t size = bits / (sizeof(HugeInt::BaseUint) * 8);
+    HugeInt m = make_RandomHugeInt(size, rng), y = make_RandomHugeInt(size, rng) % m;
+    HugeInt x = make_RandomHugeInt(size, rng) % m;
+    FixedHugeInt<2 * bits> fixed_m(m), fixed_y(y), fixed_x(x);
+    using clock = std::chrono::steady_clock;
+
+    std::cout << std::setw(10) << bits;
+    size_t initial_count = allocation_count;
+    auto start = clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        x = x * y % m;
+    auto elapsed = clock::now() - start;
+    std::cout << std::setw(20) << double(allocation_count - initial_count) / iterations
+              << std::setw(14) << std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+
+    initial_count = allocation_count;
+    start = clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        fixed_x = fixed_x * fixed_y % fixed_m;
+    elapsed = clock::now() - start;
+    std::cout << std::setw(20) << double(allocation_count - initial_count) / iterations
+              << std::setw(14) << std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+
+    // the same result, or the comparison is meaningless
+    std::cout << (FixedHugeInt<2 * bits>(x) == fixed_x ? "" : "  MISMATCH") << '\n';
+}
+
+
+static void report_FixedWidth(std::mt19937_64 &rng)
+{
+    std::cout << std::setw(10) << "bits"
+              << std::setw(20) << "HugeInt, allocs" << std::setw(14) << "HugeInt, ns"
+              << std::setw(20) << "Fixed, allocs" << std::setw(14) << "Fixed, ns" << '\n';
+    report_FixedWidthRow<256>(rng);
+    report_FixedWidthRow<512>(rng);
+    report_FixedWidthRow<1024>(rng);
+    std::cout << '\n';
+}
+
+
+/**
+ * Operation suite: time, CPU time, throughput and allocations per operation of the basic HugeInt operations on random
+ * values of sizes from 1 to 10^7 base integers (limbs). Each operation is repeated in doubling batches until it has run
+ * for at least the minimal time, the way Google Benchmark does, so that the clock isn't read around every single one.
+ */
+struct SuiteOptions
+{
+    size_t max_size = 10000000;
+    double min_time = 0.2;
+    // only the operations with the filter in their name, all of them if it's empty
+    std::string filter;
+    bool json = false;
+};
+
+
+struct SuiteResult
+{
+    std::string operation;
+    size_t size;
+    size_t iterations;
+    double ns_per_op;
+    // CPU time of the whole process, the threads of a parallel multiplication included
+    double cpu_ns_per_op;
+    double bytes_per_second;
+    double allocs_per_op;
+};
+
+
+template <typename Operation>
+static SuiteResult measure_Operation(const char *name, size_t size, double min_time, Operation operation)
+{
+    using clock = std::chrono::steady_clock;
+    size_t iterations = 0;
+    size_t initial_count = allocation_count;
+    std::clock_t cpu_start = std::clock();
+    auto start = clock::now();
+    std::chrono::duration<double> elapsed(0);
+    size_t batch = 1;
+    do
+    {
+        for (size_t i = 0; i < batch; ++i)
+            operation();
+        iterations += batch;
+        batch *= 2;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < min_time);
+    double cpu_seconds = double(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    double seconds_per_op = elapsed.count() / iterations;
+    // throughput in the bytes of a single operand
+    return {name, size, iterations, seconds_per_op * 1e9, cpu_seconds / iterations * 1e9,
+            size * sizeof(HugeInt::BaseUint) / seconds_per_op, double(allocation_count - initial_count) / iterations};
+}
+
+
+static std::vector<SuiteResult> run_OperationSuite(const SuiteOptions &options, std::mt19937_64 &rng)
+{
+    std::vector<SuiteResult> results;
+    for (size_t size = 1; size <= options.max_size; size *= 10)
+    {
+        HugeInt a = make_RandomHugeInt(size, rng);
+        HugeInt b = make_RandomHugeInt(size, rng);
+        // divided by b, for a quotient of the size of b
+        HugeInt dividend = make_RandomHugeInt(2 * size, rng);
+        // formatting takes as long as parsing, so it's done only for the parsing benchmark
+        bool is_parsed = std::strstr("parse", options.filter.c_str()) != nullptr;
+        std::string decimal = is_parsed ? a.to_String(10) : std::string();
+
+        const std::pair<const char *, std::function<void()>> operations[] = {
+            {"parse", [&] { HugeInt x(decimal); }},
+            {"format", [&] { std::string x = a.to_String(10); }},
+            {"add", [&] { HugeInt c = a + b; }},
+            {"multiply", [&] { HugeInt c = a * b; }},
+            {"square", [&] { HugeInt c = a.square(); }},
+            {"divide", [&] { HugeInt q(0), r(0); HugeInt::divmod(dividend, b, q, r); }},
+        };
+        for (auto &operation : operations)
+        {
+            if (std::strstr(operation.first, options.filter.c_str()) == nullptr)
+                continue;
+            results.push_back(measure_Operation(operation.first, size, options.min_time, operation.second));
+            if (!options.json)
+            {
+                const SuiteResult &result = results.back();
+                std::cout << std::setw(10) << result.operation << std::setw(10) << result.size
+                          << std::setw(14) << result.iterations << std::setw(18) << result.ns_per_op
+                          << std::setw(18) << result.cpu_ns_per_op
+                          << std::setw(14) << result.bytes_per_second / 1e6 << std::setw(14) << result.allocs_per_op
+                          << std::endl;
+            }
+        }
+    }
+    return results;
+}
+
+
+/**
+ * @brief Results in the JSON layout of Google Benchmark (context and benchmarks), to compare the runs of two commits
+ * with its tools or by hand.
+ */
+static void write_SuiteJson(const std::vector<SuiteResult> &results, std::ostream &os)
+{
+    os << "{\n  \"context\": {\n"
+       << "    \"base_uint_bits\": " << sizeof(HugeInt::BaseUint) * 8 << ",\n"
+       << "    \"inline_capacity\": " << HugeInt::INLINE_CAPACITY << ",\n"
+       << "    \"karatsuba_threshold\": " << HugeInt::karatsuba_threshold << ",\n"
+       << "    \"toom3_threshold\": " << HugeInt::toom3_threshold << ",\n"
+       << "    \"ntt_threshold\": " << HugeInt::ntt_threshold << ",\n"
+       << "    \"burnikel_ziegler_threshold\": " << HugeInt::burnikel_ziegler_threshold << ",\n"
+       << "    \"multiplication_threads\": " << HugeInt::multiplication_threads << "\n"
+       << "  },\n  \"benchmarks\": [";
+    os << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const SuiteResult &result = results[i];
+        os << (i ? "," : "") << "\n    {"
+           << "\"name\": \"" << result.operation << '/' << result.size << "\", "
+           << "\"operation\": \"" << result.operation << "\", "
+           << "\"limbs\": " << result.size << ", "
+           << "\"run_type\": \"iteration\", "
+           << "\"iterations\": " << result.iterations << ", "
+           << "\"real_time\": " << result.ns_per_op << ", "
+           << "\"cpu_time\": " << result.cpu_ns_per_op << ", "
+           << "\"time_unit\": \"ns\", "
+           << "\"bytes_per_second\": " << result.bytes_per_second << ", "
+           << "\"allocs_per_op\": " << result.allocs_per_op << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+
+static void report_OperationSuite(const SuiteOptions &options, std::mt19937_64 &rng)
+{
+    if (options.json)
+    {
+        write_SuiteJson(run_OperationSuite(options, rng), std::cout);
+        return;
+    }
+
+    std::cout << std::setw(10) << "operation" << std::setw(10) << "limbs" << std::setw(14) << "iterations"
+              << std::setw(18) << "time, ns" << std::setw(18) << "cpu, ns" << std::setw(14) << "MB/s" << std::setw(14) << "allocs" << '\n';
+    run_OperationSuite(options, rng);
+    std::cout << '\n';
+}
+
+
+static void print_Usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [--suite] [--json] [--max_limbs=N] [--min_time=SECONDS] [--filter=NAME]\n"
+              << "  --suite        run only the operation suite (parse, format, add, multiply, square, divide)\n"
+              << "  --json         write the operation suite results as JSON to the standard output, implies --suite\n"
+              << "  --max_limbs    largest operand size of the suite, 10000000 by default\n"
+              << "  --min_time     minimal time each operation of the suite runs for, 0.2 s by default\n"
+              << "  --filter       run only the suite operations with NAME in their name\n";
+}
+
+
+struct Algorithm
+{
+    const char *name;
+    size_t karatsuba_threshold;
+    size_t toom3_threshold;
+    size_t ntt_threshold;
+    // largest size still measured, the slower algorithms take too long on the bigger ones
+    size_t max_size;
+};
+
+
+int main(int argc, char **argv)
+{
+    SuiteOptions options;
+    bool is_suite_only = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto get_Value = [&arg](const char *prefix) { return arg.substr(std::strlen(prefix)); };
+        if (arg == "--suite")
+            is_suite_only = true;
+        else if (arg == "--json")
+            is_suite_only = options.json = true;
+        else if (arg.rfind("--max_limbs=", 0) == 0)
+            options.max_size = std::stoull(get_Value("--max_limbs="));
+        else if (arg.rfind("--min_time=", 0) == 0)
+            options.min_time = std::stod(get_Value("--min_time="));
+        else if (arg.rfind("--filter=", 0) == 0)
+            options.filter = get_Value("--filter=");
+        else
+        {
+            print_Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::mt19937_64 rng(42);
+    report_OperationSuite(options, rng);
+    if (is_suite_only)
+        return 0;
+
+    report_SmallValueAllocations(rng);
+    report_AccumulationAllocations(rng);
+    report_AllocatorComparison(rng);
+    report_FixedWidth(rng);
+
+    static constexpr size_t never = std::numeric_limits<size_t>::max();
+    const Algorithm algorithms[] = {
+        {"schoolbook", never, never, never, 1 << 14},
+        {"karatsuba", HugeInt::karatsuba_threshold, never, never, 1 << 16},
+        {"toom3", HugeInt::karatsuba_threshold, HugeInt::toom3_threshold, never, 1 << 18},
+        {"dispatched", HugeInt::karatsuba_threshold, HugeInt::toom3_threshold, HugeInt::ntt_threshold, 1 << 21},
+    };
+
+    std::cout << "karatsuba_threshold = " << HugeInt::karatsuba_threshold
+              << ", toom3_threshold = " << HugeInt::toom3_threshold
+              << ", ntt_threshold = " << HugeInt::ntt_threshold << "\n\n";
+    std::cout << std::setw(10) << "limbs";
+    for (auto &algorithm : algorithms)
+        std::cout << std::setw(14) << algorithm.name << ", us";
+    std::cout << '\n';
+
+    for (size_t size = 8; size <= (1 << 21); size *= 2)
+    {
+        std::cout << std::setw(10) << size;
+        for (auto &algorithm : algorithms)
+        {
+            HugeInt::karatsuba_threshold = algorithm.karatsuba_threshold;
+            HugeInt::toom3_threshold = algorithm.toom3_threshold;
+            HugeInt::ntt_threshold = algorithm.ntt_threshold;
+            if (size <= algorithm.max_size)
+                std::cout << std::setw(18) << measure_Multiplication(size, rng);
+            else
+                std::cout << std::setw(18) << '-';
+        }
+        std::cout << std::endl;
+    }
+}
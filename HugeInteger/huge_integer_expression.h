@@ -0,0 +1,270 @@
+#ifndef __HUGE_INTEGER_EXPRESSION__
+#define __HUGE_INTEGER_EXPRESSION__
+
+
+#include <cstddef>
+
+#include "huge_integer.h"
+
+
+
+/**
+ * Lazy evaluation of HugeInt arithmetic. Sums, differences and products of HugeInts compute nothing by themselves,
+ * they only collect the terms into a HugeIntExpression: a * b + c * d - e is the list {+a*b, +c*d, -e}.
+ * The whole list is computed when it's assigned to (or added to) a HugeInt, right in the memory of the result: small
+ * products are multiplied and accumulated into it row by row, the large ones go through a single scratch buffer,
+ * and there are no intermediate HugeInts. A product of an expression is not a sum of terms anymore, so it's computed
+ * at once, just like division.
+ *
+ * Expressions refer to their operands, so they have to be computed before the end of the full expression that made
+ * them: 'HugeInt x = a * b + 1;' is fine, while 'auto x = a * b + 1;' keeps a reference to the destroyed HugeInt(1).
+ */
+
+
+/**
+ * @brief One term of an expression: 'a' times 'b' (or just 'a' if 'b' is null), negated if 'negative'.
+ */
+struct HugeIntTerm
+{
+    const HugeInt *a;
+    const HugeInt *b;
+    bool negative;
+
+    bool refers_To(const HugeInt &x) const
+    {
+        return a == &x || b == &x;
+    }
+};
+
+
+template <size_t num_terms>
+class HugeIntExpression
+{
+    template <size_t> friend class HugeIntExpression;
+    friend class HugeInt;
+
+    HugeIntTerm terms[num_terms];
+
+public:
+    explicit HugeIntExpression(const HugeIntTerm &term) : terms{term}
+    {
+        static_assert(num_terms == 1, "Only a single term expression is made of a term.");
+    }
+
+    // Terms of 'left' followed by the terms of 'right', the latter negated if 'subtract_right'.
+    template <size_t num_left_terms>
+    HugeIntExpression(const HugeIntExpression<num_left_terms> &left,
+                      const HugeIntExpression<num_terms - num_left_terms> &right, bool subtract_right)
+    {
+        for (size_t i = 0; i < num_left_terms; ++i)
+            terms[i] = left.terms[i];
+        for (size_t i = num_left_terms; i < num_terms; ++i)
+        {
+            terms[i] = right.terms[i - num_left_terms];
+            terms[i].negative ^= subtract_right;
+        }
+    }
+
+    HugeIntExpression operator-() const
+    {
+        HugeIntExpression negated = *this;
+        for (auto &term : negated.terms)
+            term.negative = !term.negative;
+        return negated;
+    }
+};
+
+
+template <size_t num_terms>
+HugeInt::HugeInt(const HugeIntExpression<num_terms> &expression) : HugeInt(0)
+{
+    evaluate(expression.terms, num_terms, false);
+}
+
+
+template <size_t num_terms>
+HugeInt& HugeInt::operator=(const HugeIntExpression<num_terms> &expression)
+{
+    evaluate(expression.terms, num_terms, false);
+    return *this;
+}
+
+
+template <size_t num_terms>
+HugeInt& HugeInt::operator+=(const HugeIntExpression<num_terms> &expression)
+{
+    evaluate(expression.terms, num_terms, true);
+    return *this;
+}
+
+
+template <size_t num_terms>
+HugeInt& HugeInt::operator-=(const HugeIntExpression<num_terms> &expression)
+{
+    return *this += -expression;
+}
+
+
+inline HugeIntExpression<1> as_Expression(const HugeInt &x)
+{
+    return HugeIntExpression<1>(HugeIntTerm{&x, nullptr, false});
+}
+
+
+template <size_t num_terms>
+const HugeIntExpression<num_terms> &as_Expression(const HugeIntExpression<num_terms> &x)
+{
+    return x;
+}
+
+
+inline HugeIntExpression<2> operator+(const HugeInt &a, const HugeInt &b)
+{
+    return HugeIntExpression<2>(as_Expression(a), as_Expression(b), false);
+}
+
+
+template <size_t n>
+HugeIntExpression<n + 1> operator+(const HugeIntExpression<n> &a, const HugeInt &b)
+{
+    return HugeIntExpression<n + 1>(a, as_Expression(b), false);
+}
+
+
+template <size_t n>
+HugeIntExpression<n + 1> operator+(const HugeInt &a, const HugeIntExpression<n> &b)
+{
+    return HugeIntExpression<n + 1>(as_Expression(a), b, false);
+}
+
+
+template <size_t n, size_t m>
+HugeIntExpression<n + m> operator+(const HugeIntExpression<n> &a, const HugeIntExpression<m> &b)
+{
+    return HugeIntExpression<n + m>(a, b, false);
+}
+
+
+inline HugeIntExpression<2> operator-(const HugeInt &a, const HugeInt &b)
+{
+    return HugeIntExpression<2>(as_Expression(a), as_Expression(b), true);
+}
+
+
+template <size_t n>
+HugeIntExpression<n + 1> operator-(const HugeIntExpression<n> &a, const HugeInt &b)
+{
+    return HugeIntExpression<n + 1>(a, as_Expression(b), true);
+}
+
+
+template <size_t n>
+HugeIntExpression<n + 1> operator-(const HugeInt &a, const HugeIntExpression<n> &b)
+{
+    return HugeIntExpression<n + 1>(as_Expression(a), b, true);
+}
+
+
+template <size_t n, size_t m>
+HugeIntExpression<n + m> operator-(const HugeIntExpression<n> &a, const HugeIntExpression<m> &b)
+{
+    return HugeIntExpression<n + m>(a, b, true);
+}
+
+
+inline HugeIntExpression<1> operator-(const HugeInt &x)
+{
+    return HugeIntExpression<1>(HugeIntTerm{&x, nullptr, true});
+}
+
+
+inline HugeIntExpression<1> operator*(const HugeInt &a, const HugeInt &b)
+{
+    return HugeIntExpression<1>(HugeIntTerm{&a, &b, false});
+}
+
+
+// Products, quotients, remainders, shifts and bitwise operations of expressions compute the expressions first.
+
+template <size_t n>
+HugeInt operator*(const HugeIntExpression<n> &a, const HugeInt &b)
+{
+    HugeInt a_value = a;
+    return a_value * b;
+}
+
+
+template <size_t n>
+HugeInt operator*(const HugeInt &a, const HugeIntExpression<n> &b)
+{
+    HugeInt b_value = b;
+    return a * b_value;
+}
+
+
+template <size_t n, size_t m>
+HugeInt operator*(const HugeIntExpression<n> &a, const HugeIntExpression<m> &b)
+{
+    HugeInt a_value = a, b_value = b;
+    return a_value * b_value;
+}
+
+
+template <size_t n>
+HugeInt operator/(const HugeIntExpression<n> &a, const HugeInt &b)
+{
+    return HugeInt(a) / b;
+}
+
+
+template <size_t n>
+HugeInt operator%(const HugeIntExpression<n> &a, const HugeInt &b)
+{
+    return HugeInt(a) % b;
+}
+
+
+
+template <size_t n>
+HugeInt operator<<(const HugeIntExpression<n> &x, size_t shift)
+{
+    return HugeInt(x) << shift;
+}
+
+
+template <size_t n>
+HugeInt operator>>(const HugeIntExpression<n> &x, size_t shift)
+{
+    return HugeInt(x) >> shift;
+}
+
+
+template <size_t n>
+HugeInt operator&(const HugeIntExpression<n> &a, const HugeInt &b)
+{
+    return HugeInt(a) & b;
+}
+
+
+template <size_t n>
+HugeInt operator|(const HugeIntExpression<n> &a, const HugeInt &b)
+{
+    return HugeInt(a) | b;
+}
+
+
+template <size_t n>
+HugeInt operator^(const HugeIntExpression<n> &a, const HugeInt &b)
+{
+    return HugeInt(a) ^ b;
+}
+
+
+template <size_t n>
+HugeInt operator~(const HugeIntExpression<n> &x)
+{
+    return ~HugeInt(x);
+}
+
+
+#endif
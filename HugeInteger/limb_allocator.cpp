@@ -0,0 +1,147 @@
+#include "limb_allocator.h"
+#include <cstring>
+#include <algorithm>
+
+
+
+HeapLimbAllocator::BaseUint *HeapLimbAllocator::allocate(size_t count)
+{
+    return new BaseUint[count];
+}
+
+
+void HeapLimbAllocator::deallocate(BaseUint *ptr, size_t) noexcept
+{
+    delete[] ptr;
+}
+
+
+HeapLimbAllocator &HeapLimbAllocator::get_Instance()
+{
+    static HeapLimbAllocator instance;
+    return instance;
+}
+
+
+
+ArenaLimbAllocator::ArenaLimbAllocator(size_t min_block_size) : min_block_size(min_block_size) {}
+
+
+ArenaLimbAllocator::~ArenaLimbAllocator()
+{
+    for (auto &block : blocks)
+        delete[] block.begin;
+}
+
+
+void ArenaLimbAllocator::add_Block(size_t size)
+{
+    blocks.push_back({new BaseUint[size], size});
+    top = blocks.back().begin;
+    end = top + size;
+}
+
+
+ArenaLimbAllocator::BaseUint *ArenaLimbAllocator::allocate(size_t count)
+{
+    if (size_t(end - top) < count)
+        add_Block(std::max(count, min_block_size));
+
+    BaseUint *ptr = top;
+    top += count;
+    return ptr;
+}
+
+
+void ArenaLimbAllocator::deallocate(BaseUint *ptr, size_t count) noexcept
+{
+    if (ptr + count == top)
+        top = ptr;
+}
+
+
+void ArenaLimbAllocator::release()
+{
+    if (blocks.size() > 1)
+    {
+        // next time everything will fit in one block
+        size_t total_size = 0;
+        for (auto &block : blocks)
+        {
+            total_size += block.size;
+            delete[] block.begin;
+        }
+        blocks.clear();
+        add_Block(total_size);
+    }
+    else if (!blocks.empty())
+        top = blocks.back().begin;
+}
+
+
+
+PoolLimbAllocator::~PoolLimbAllocator()
+{
+    for (auto *&head : free_lists)
+    {
+        while (head)
+        {
+            BaseUint *next;
+            std::memcpy(&next, head, sizeof(next));
+            delete[] head;
+            head = next;
+        }
+    }
+}
+
+
+size_t PoolLimbAllocator::get_SizeClass(size_t count)
+{
+    // every block must be able to hold the free list pointer
+    static constexpr size_t min_count = (sizeof(BaseUint *) + sizeof(BaseUint) - 1) / sizeof(BaseUint);
+    count = std::max(count, min_count);
+
+    size_t size_class = 0;
+    while ((size_t(1) << size_class) < count)
+        ++size_class;
+    return size_class;
+}
+
+
+PoolLimbAllocator::BaseUint *PoolLimbAllocator::allocate(size_t count)
+{
+    size_t size_class = get_SizeClass(count);
+    BaseUint *&head = free_lists[size_class];
+    if (!head)
+        return new BaseUint[size_t(1) << size_class];
+
+    BaseUint *ptr = head;
+    std::memcpy(&head, ptr, sizeof(head));
+    return ptr;
+}
+
+
+void PoolLimbAllocator::deallocate(BaseUint *ptr, size_t count) noexcept
+{
+    BaseUint *&head = free_lists[get_SizeClass(count)];
+    std::memcpy(ptr, &head, sizeof(head));
+    head = ptr;
+}
+
+
+
+static thread_local LimbAllocator *current_allocator = &HeapLimbAllocator::get_Instance();
+
+
+LimbAllocator &get_CurrentLimbAllocator()
+{
+    return *current_allocator;
+}
+
+
+LimbAllocator &set_CurrentLimbAllocator(LimbAllocator &allocator)
+{
+    LimbAllocator &previous = *current_allocator;
+    current_allocator = &allocator;
+    return previous;
+}
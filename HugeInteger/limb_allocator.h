@@ -0,0 +1,152 @@
+#ifndef __LIMB_ALLOCATOR__
+#define __LIMB_ALLOCATOR__
+
+
+#include <cstddef>
+#include <vector>
+
+#include "huge_integer.h"
+
+
+
+/**
+ * Allocators of memory for base integers (limbs) - both the ones HugeInt values live in and the scratch ones of
+ * the arithmetic routines. Each thread has a current allocator (the global heap by default) that all new allocations
+ * on it go through. Memory is always returned to the allocator that gave it, so values allocated by different
+ * allocators can be mixed freely as long as the allocators outlive them.
+ */
+class LimbAllocator
+{
+public:
+    using BaseUint = HugeInt::BaseUint;
+
+    virtual ~LimbAllocator() = default;
+
+    // Uninitialized memory for 'count' > 0 base integers.
+    virtual BaseUint *allocate(size_t count) = 0;
+    // Give back memory allocated by this allocator with the same 'count'.
+    virtual void deallocate(BaseUint *ptr, size_t count) noexcept = 0;
+};
+
+
+/**
+ * @brief Plain new[]/delete[] allocator.
+ */
+class HeapLimbAllocator : public LimbAllocator
+{
+public:
+    BaseUint *allocate(size_t count) override;
+    void deallocate(BaseUint *ptr, size_t count) noexcept override;
+
+    // The allocator every thread starts with.
+    static HeapLimbAllocator &get_Instance();
+};
+
+
+/**
+ * @brief Bump allocator for batch computations. Allocation is a pointer increment, deallocation does nothing unless it's
+ * the last allocation (the scratch memory of arithmetic routines is freed in the reverse order, so it gets reused).
+ * All the memory is released at once by release(), after which nothing allocated from the arena may be used anymore.
+ */
+class ArenaLimbAllocator : public LimbAllocator
+{
+    struct Block
+    {
+        BaseUint *begin;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t min_block_size;
+    // bump pointer into the last block and the end of it
+    BaseUint *top = nullptr;
+    BaseUint *end = nullptr;
+
+public:
+    explicit ArenaLimbAllocator(size_t min_block_size = 1 << 16);
+    ArenaLimbAllocator(const ArenaLimbAllocator &) = delete;
+    ArenaLimbAllocator& operator=(const ArenaLimbAllocator &) = delete;
+    ~ArenaLimbAllocator() override;
+
+    BaseUint *allocate(size_t count) override;
+    void deallocate(BaseUint *ptr, size_t count) noexcept override;
+
+    // Free everything allocated so far. Memory is kept for further allocations, merged into a single block.
+    void release();
+
+private:
+    void add_Block(size_t size);
+};
+
+
+/**
+ * @brief Allocator with a free list per power of 2 size class. Deallocated memory isn't returned to the heap but reused by
+ * the next allocations of the same size class, so a steady state computation stops calling malloc at all.
+ */
+class PoolLimbAllocator : public LimbAllocator
+{
+    static constexpr size_t NUM_SIZE_CLASSES = sizeof(size_t) * 8;
+
+    // heads of singly linked lists of free blocks, each free block stores the pointer to the next one in its beginning
+    BaseUint *free_lists[NUM_SIZE_CLASSES] = {};
+
+public:
+    PoolLimbAllocator() = default;
+    PoolLimbAllocator(const PoolLimbAllocator &) = delete;
+    PoolLimbAllocator& operator=(const PoolLimbAllocator &) = delete;
+    ~PoolLimbAllocator() override;
+
+    BaseUint *allocate(size_t count) override;
+    void deallocate(BaseUint *ptr, size_t count) noexcept override;
+
+private:
+    static size_t get_SizeClass(size_t count);
+};
+
+
+// Allocator of the calling thread.
+LimbAllocator &get_CurrentLimbAllocator();
+// Set allocator of the calling thread, returns the previous one.
+LimbAllocator &set_CurrentLimbAllocator(LimbAllocator &allocator);
+
+
+/**
+ * @brief Makes the allocator current for the calling thread until the end of the scope.
+ */
+class ScopedLimbAllocator
+{
+    LimbAllocator &previous;
+
+public:
+    explicit ScopedLimbAllocator(LimbAllocator &allocator) : previous(set_CurrentLimbAllocator(allocator)) {}
+    ScopedLimbAllocator(const ScopedLimbAllocator &) = delete;
+    ScopedLimbAllocator& operator=(const ScopedLimbAllocator &) = delete;
+    ~ScopedLimbAllocator() { set_CurrentLimbAllocator(previous); }
+};
+
+
+/**
+ * @brief Uninitialized scratch array of base integers from the current allocator, given back at the end of the scope.
+ */
+class LimbBuffer
+{
+    LimbAllocator &allocator;
+    LimbAllocator::BaseUint *ptr;
+    size_t count;
+
+public:
+    explicit LimbBuffer(size_t count)
+        : allocator(get_CurrentLimbAllocator()), ptr(count ? allocator.allocate(count) : nullptr), count(count) {}
+    LimbBuffer(const LimbBuffer &) = delete;
+    LimbBuffer& operator=(const LimbBuffer &) = delete;
+    ~LimbBuffer()
+    {
+        if (ptr)
+            allocator.deallocate(ptr, count);
+    }
+
+    LimbAllocator::BaseUint *data() { return ptr; }
+};
+
+
+#endif
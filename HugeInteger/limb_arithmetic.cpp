@@ -0,0 +1,664 @@
+#include "limb_arithmetic.h"
+#include "limb_allocator.h"
+#include "limb_kernels_x86_64.h"
+#include "parallel_tasks.h"
+#include <algorithm>
+#include <cstring>
+
+
+
+namespace limbs
+{
+
+
+#ifdef HUGE_INT_X86_64_KERNELS
+// Checked once at startup. Anything running before that sees false and takes the portable code, which is just slower.
+static const bool use_mulx_adx = x86_64::has_MulxAdx();
+static const bool use_popcnt = x86_64::has_Popcnt();
+#endif
+
+
+Limb add_Limbs(Limb *r, const Limb *a, const Limb *b, size_t n)
+{
+#ifdef HUGE_INT_X86_64_KERNELS
+    return x86_64::add_Limbs(r, a, b, n);
+#else
+    Limb carry = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        DoubleLimb s = DoubleLimb(a[i]) + b[i] + carry;
+        r[i] = Limb(s);
+        carry = Limb(s >> LIMB_BITS);
+    }
+    return carry;
+#endif
+}
+
+
+Limb subtract_Limbs(Limb *r, const Limb *a, const Limb *b, size_t n)
+{
+#ifdef HUGE_INT_X86_64_KERNELS
+    return x86_64::subtract_Limbs(r, a, b, n);
+#else
+    Limb borrow = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        Limb a_i = a[i], b_i = b[i];
+        Limb d = a_i - b_i;
+        Limb next_borrow = a_i < b_i || d < borrow;
+        r[i] = d - borrow;
+        borrow = next_borrow;
+    }
+    return borrow;
+#endif
+}
+
+
+Limb add_Into(Limb *r, size_t rn, const Limb *a, size_t an)
+{
+    Limb carry = add_Limbs(r, r, a, an);
+    for (size_t i = an; carry && i < rn; ++i)
+        carry = ++r[i] == 0;
+    return carry;
+}
+
+
+Limb subtract_From(Limb *r, size_t rn, const Limb *a, size_t an)
+{
+    Limb borrow = subtract_Limbs(r, r, a, an);
+    for (size_t i = an; borrow && i < rn; ++i)
+        borrow = r[i]-- == 0;
+    return borrow;
+}
+
+
+Limb multiply_by_Limb(Limb *r, const Limb *a, size_t n, Limb b)
+{
+#ifdef HUGE_INT_X86_64_KERNELS
+    if (use_mulx_adx)
+        return x86_64::multiply_by_Limb(r, a, n, b);
+#endif
+    Limb carry = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        DoubleLimb p = DoubleLimb(a[i]) * b + carry;
+        r[i] = Limb(p);
+        carry = Limb(p >> LIMB_BITS);
+    }
+    return carry;
+}
+
+
+Limb add_multiplied_by_Limb(Limb *r, const Limb *a, size_t n, Limb b)
+{
+#ifdef HUGE_INT_X86_64_KERNELS
+    if (use_mulx_adx)
+        return x86_64::add_multiplied_by_Limb(r, a, n, b);
+#endif
+    Limb carry = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        // (2^k - 1)^2 + 2 * (2^k - 1) == 2^2k - 1, so this never overloads
+        DoubleLimb p = DoubleLimb(a[i]) * b + r[i] + carry;
+        r[i] = Limb(p);
+        carry = Limb(p >> LIMB_BITS);
+    }
+    return carry;
+}
+
+
+Limb subtract_multiplied_by_Limb(Limb *r, const Limb *a, size_t n, Limb b)
+{
+    Limb borrow = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        DoubleLimb p = DoubleLimb(a[i]) * b + borrow;
+        Limb low = Limb(p);
+        borrow = Limb(p >> LIMB_BITS) + (r[i] < low);
+        r[i] -= low;
+    }
+    return borrow;
+}
+
+
+Limb divide_by_Limb(Limb *q, const Limb *a, size_t n, Limb d)
+{
+    Limb remainder = 0;
+    for (size_t i = n; i-- > 0;)
+    {
+        DoubleLimb current = (DoubleLimb(remainder) << LIMB_BITS) | a[i];
+        q[i] = Limb(current / d);
+        remainder = Limb(current % d);
+    }
+    return remainder;
+}
+
+
+// Every limb of the result is made of two neighbouring limbs of a, so the iterations are independent and the loops
+// vectorize. The order (from the top for the left shift) reads each limb before it's overwritten when r and a overlap.
+Limb shift_Left(Limb *r, const Limb *a, size_t n, unsigned shift)
+{
+    if (n == 0)
+        return 0;
+    if (shift == 0)
+    {
+        if (r != a)
+            std::memmove(r, a, n * sizeof(Limb));
+        return 0;
+    }
+
+    Limb shifted_out = a[n - 1] >> (LIMB_BITS - shift);
+    for (size_t i = n - 1; i > 0; --i)
+        r[i] = (a[i] << shift) | (a[i - 1] >> (LIMB_BITS - shift));
+    r[0] = a[0] << shift;
+    return shifted_out;
+}
+
+
+Limb shift_Right(Limb *r, const Limb *a, size_t n, unsigned shift)
+{
+    if (n == 0)
+        return 0;
+    if (shift == 0)
+    {
+        if (r != a)
+            std::memmove(r, a, n * sizeof(Limb));
+        return 0;
+    }
+
+    Limb shifted_out = a[0] << (LIMB_BITS - shift);
+    for (size_t i = 0; i + 1 < n; ++i)
+        r[i] = (a[i] >> shift) | (a[i + 1] << (LIMB_BITS - shift));
+    r[n - 1] = a[n - 1] >> shift;
+    return shifted_out;
+}
+
+
+unsigned count_LeadingZeros(Limb x)
+{
+    if constexpr (sizeof(Limb) <= sizeof(unsigned))
+        return __builtin_clz(x) - (sizeof(unsigned) - sizeof(Limb)) * 8;
+    else
+        return __builtin_clzll(x);
+}
+
+
+unsigned count_TrailingZeros(Limb x)
+{
+    if constexpr (sizeof(Limb) <= sizeof(unsigned))
+        return __builtin_ctz(x);
+    else
+        return __builtin_ctzll(x);
+}
+
+
+size_t count_SetBits(const Limb *a, size_t n)
+{
+#ifdef HUGE_INT_X86_64_KERNELS
+    if (use_popcnt)
+        return x86_64::count_SetBits(a, n);
+#endif
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if constexpr (sizeof(Limb) <= sizeof(unsigned))
+            count += __builtin_popcount(a[i]);
+        else
+            count += __builtin_popcountll(a[i]);
+    }
+    return count;
+}
+
+
+void negate_Limbs(Limb *a, size_t n)
+{
+    Limb carry = 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        a[i] = ~a[i] + carry;
+        carry = carry && a[i] == 0;
+    }
+}
+
+
+size_t get_NormalizedSize(const Limb *a, size_t n)
+{
+    while (n > 0 && a[n - 1] == 0)
+        --n;
+    return n;
+}
+
+
+int compare_Limbs(const Limb *a, const Limb *b, size_t n)
+{
+    for (size_t i = n; i-- > 0;)
+    {
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+
+void multiply_Schoolbook(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn)
+{
+    r[an] = multiply_by_Limb(r, a, an, b[0]);
+    for (size_t i = 1; i < bn; ++i)
+        r[an + i] = add_multiplied_by_Limb(r + i, a, an, b[i]);
+}
+
+
+void square_Schoolbook(Limb *r, const Limb *a, size_t n)
+{
+    // every product a[i] * a[j] with i != j appears twice, so the ones with i < j are summed up and doubled
+    std::fill(r, r + 2 * n, 0);
+    for (size_t i = 0; i + 1 < n; ++i)
+        r[n + i] = add_multiplied_by_Limb(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    shift_Left(r, r, 2 * n, 1);
+
+    // then the squares a[i]^2 are added on the diagonal
+    Limb carry = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        DoubleLimb square = DoubleLimb(a[i]) * a[i];
+        DoubleLimb s = DoubleLimb(r[2 * i]) + Limb(square) + carry;
+        r[2 * i] = Limb(s);
+        s = DoubleLimb(r[2 * i + 1]) + Limb(square >> LIMB_BITS) + Limb(s >> LIMB_BITS);
+        r[2 * i + 1] = Limb(s);
+        carry = Limb(s >> LIMB_BITS);
+    }
+}
+
+
+/**
+ * @brief Multiplication of operands of too different sizes (an >= 2 * bn roughly) by splitting 'a' into bn sized chunks,
+ * so that each chunk product is balanced and can use the faster algorithms.
+ */
+static void multiply_Unbalanced(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn)
+{
+    std::fill(r, r + an + bn, 0);
+    LimbBuffer chunk_product(2 * bn);
+
+    for (size_t offset = 0; offset < an; offset += bn)
+    {
+        size_t chunk_size = std::min(bn, an - offset);
+        if (chunk_size == bn)
+            multiply_Limbs(chunk_product.data(), a + offset, chunk_size, b, bn);
+        else
+            multiply_Limbs(chunk_product.data(), b, bn, a + offset, chunk_size);
+        add_Into(r + offset, an + bn - offset, chunk_product.data(), chunk_size + bn);
+    }
+}
+
+
+/**
+ * @brief Karatsuba multiplication. Requires (an + 1) / 2 < bn <= an.
+ *
+ * With a = a1 * B^k + a0 and b = b1 * B^k + b0:
+ * a * b = z2 * B^2k + ((a0 + a1) * (b0 + b1) - z2 - z0) * B^k + z0, where z2 = a1 * b1, z0 = a0 * b0.
+ * All the intermediate values are non-negative, so no sign tracking is needed.
+ */
+static void multiply_Karatsuba(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn)
+{
+    size_t k = (an + 1) / 2;
+    size_t a1n = an - k, b1n = bn - k;
+
+    LimbBuffer buffer(4 * (k + 1));
+    Limb *a_sum = buffer.data();
+    Limb *b_sum = a_sum + k + 1;
+    Limb *z1 = b_sum + k + 1;
+
+    std::copy(a, a + k, a_sum);
+    a_sum[k] = add_Into(a_sum, k, a + k, a1n);
+    std::copy(b, b + k, b_sum);
+    b_sum[k] = add_Into(b_sum, k, b + k, b1n);
+
+    // z0 and z2 go right to their places in the result
+    size_t z1n = 2 * k + 2;
+    run_Tasks(k,
+              [&] { multiply_Limbs(r, a, k, b, k); },
+              [&] { multiply_Limbs(r + 2 * k, a + k, a1n, b + k, b1n); },
+              [&] { multiply_Limbs(z1, a_sum, k + 1, b_sum, k + 1); });
+    subtract_From(z1, z1n, r, 2 * k);
+    subtract_From(z1, z1n, r + 2 * k, a1n + b1n);
+
+    add_Into(r + k, an + bn - k, z1, get_NormalizedSize(z1, z1n));
+}
+
+
+/**
+ * @brief Karatsuba squaring, same as multiplication with b = a but with a single sum and squares only. Requires n >= 4.
+ */
+static void square_Karatsuba(Limb *r, const Limb *a, size_t n)
+{
+    size_t k = (n + 1) / 2;
+    size_t a1n = n - k;
+
+    LimbBuffer buffer(3 * (k + 1));
+    Limb *a_sum = buffer.data();
+    Limb *z1 = a_sum + k + 1;
+
+    std::copy(a, a + k, a_sum);
+    a_sum[k] = add_Into(a_sum, k, a + k, a1n);
+
+    size_t z1n = 2 * k + 2;
+    run_Tasks(k,
+              [&] { square_Limbs(r, a, k); },
+              [&] { square_Limbs(r + 2 * k, a + k, a1n); },
+              [&] { square_Limbs(z1, a_sum, k + 1); });
+    subtract_From(z1, z1n, r, 2 * k);
+    subtract_From(z1, z1n, r + 2 * k, 2 * a1n);
+
+    add_Into(r + k, 2 * n - k, z1, get_NormalizedSize(z1, z1n));
+}
+
+
+/**
+ * @brief Evaluate x0 + x1 * point + x2 * point^2 into k + 1 limbs of 'e', where x0 and x1 have k limbs and x2 has x2n <= k limbs.
+ */
+static void evaluate_Toom3(Limb *e, const Limb *x, size_t k, size_t x2n, Limb point)
+{
+    std::copy(x, x + k, e);
+    e[k] = add_multiplied_by_Limb(e, x + k, k, point);
+    Limb carry = add_multiplied_by_Limb(e, x + 2 * k, x2n, point * point);
+    add_Into(e + x2n, k + 1 - x2n, &carry, 1);
+}
+
+
+/**
+ * @brief Find c1, c2, c3 of the Toom-3 product from the products p1, p2, p3 (2k + 2 limbs each, overwritten) of the
+ * evaluations at 1, 2 and 3 and add them to r (rn limbs), where c0 and c4 (c4n limbs) are already in their places.
+ */
+static void interpolate_Toom3(Limb *r, size_t rn, size_t k, size_t c4n, Limb *p1, Limb *p2, Limb *p3);
+
+/**
+ * @brief Toom-3 multiplication. Requires 2 * ((an + 2) / 3) < bn <= an.
+ *
+ * Both operands are split into 3 parts and treated as polynomials of B^k. The product polynomial c4..c0 is evaluated
+ * at the points 0, 1, 2, 3 and infinity. Non-negative points are chosen on purpose: every evaluation and every step of
+ * the interpolation below stays non-negative, which lets it work on plain magnitudes:
+ *  s1 = r(1) - c0 - c4           = c1 + c2 + c3
+ *  s2 = (r(2) - c0 - 16 c4) / 2  = c1 + 2 c2 + 4 c3
+ *  s3 = (r(3) - c0 - 81 c4) / 3  = c1 + 3 c2 + 9 c3
+ *  c3 = ((s3 - s2) - (s2 - s1)) / 2, c2 = (s2 - s1) - 3 c3, c1 = s1 - c2 - c3
+ */
+static void multiply_Toom3(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn)
+{
+    size_t k = (an + 2) / 3;
+    size_t a2n = an - 2 * k, b2n = bn - 2 * k;
+    size_t c4n = a2n + b2n;
+
+    // evaluations of a and b at 1, 2, 3 and the products of them
+    size_t pn = 2 * k + 2;
+    LimbBuffer buffer(6 * (k + 1) + 3 * pn);
+    Limb *a_vals = buffer.data();
+    Limb *b_vals = a_vals + 3 * (k + 1);
+    Limb *p1 = b_vals + 3 * (k + 1);
+    Limb *p2 = p1 + pn;
+    Limb *p3 = p2 + pn;
+
+    for (Limb point = 1; point <= 3; ++point)
+    {
+        evaluate_Toom3(a_vals + (point - 1) * (k + 1), a, k, a2n, point);
+        evaluate_Toom3(b_vals + (point - 1) * (k + 1), b, k, b2n, point);
+    }
+
+    // c0 and c4 go right to their places in the result
+    std::fill(r + 2 * k, r + 4 * k, 0);
+    run_Tasks(k,
+              [&] { multiply_Limbs(r, a, k, b, k); },
+              [&] { multiply_Limbs(r + 4 * k, a + 2 * k, a2n, b + 2 * k, b2n); },
+              [&] { multiply_Limbs(p1, a_vals, k + 1, b_vals, k + 1); },
+              [&] { multiply_Limbs(p2, a_vals + (k + 1), k + 1, b_vals + (k + 1), k + 1); },
+              [&] { multiply_Limbs(p3, a_vals + 2 * (k + 1), k + 1, b_vals + 2 * (k + 1), k + 1); });
+
+    interpolate_Toom3(r, an + bn, k, c4n, p1, p2, p3);
+}
+
+
+/**
+ * @brief Toom-3 squaring, same as multiplication with b = a but with a single evaluation at each point and squares only.
+ * Requires n > 2 * ((n + 2) / 3), true for n >= 5.
+ */
+static void square_Toom3(Limb *r, const Limb *a, size_t n)
+{
+    size_t k = (n + 2) / 3;
+    size_t a2n = n - 2 * k;
+
+    size_t pn = 2 * k + 2;
+    LimbBuffer buffer(3 * (k + 1) + 3 * pn);
+    Limb *a_vals = buffer.data();
+    Limb *p1 = a_vals + 3 * (k + 1);
+    Limb *p2 = p1 + pn;
+    Limb *p3 = p2 + pn;
+
+    for (Limb point = 1; point <= 3; ++point)
+        evaluate_Toom3(a_vals + (point - 1) * (k + 1), a, k, a2n, point);
+
+    std::fill(r + 2 * k, r + 4 * k, 0);
+    run_Tasks(k,
+              [&] { square_Limbs(r, a, k); },
+              [&] { square_Limbs(r + 4 * k, a + 2 * k, a2n); },
+              [&] { square_Limbs(p1, a_vals, k + 1); },
+              [&] { square_Limbs(p2, a_vals + (k + 1), k + 1); },
+              [&] { square_Limbs(p3, a_vals + 2 * (k + 1), k + 1); });
+
+    interpolate_Toom3(r, 2 * n, k, 2 * a2n, p1, p2, p3);
+}
+
+
+static void interpolate_Toom3(Limb *r, size_t rn, size_t k, size_t c4n, Limb *p1, Limb *p2, Limb *p3)
+{
+    size_t pn = 2 * k + 2;
+    const Limb *c0 = r;
+    const Limb *c4 = r + 4 * k;
+
+    subtract_From(p1, pn, c0, 2 * k);
+    subtract_From(p1, pn, c4, c4n);
+
+    Limb borrow;
+    subtract_From(p2, pn, c0, 2 * k);
+    borrow = subtract_multiplied_by_Limb(p2, c4, c4n, 16);
+    subtract_From(p2 + c4n, pn - c4n, &borrow, 1);
+    divide_by_Limb(p2, p2, pn, 2);
+
+    subtract_From(p3, pn, c0, 2 * k);
+    borrow = subtract_multiplied_by_Limb(p3, c4, c4n, 81);
+    subtract_From(p3 + c4n, pn - c4n, &borrow, 1);
+    divide_by_Limb(p3, p3, pn, 3);
+
+    subtract_Limbs(p3, p3, p2, pn);     // s3 - s2
+    subtract_Limbs(p2, p2, p1, pn);     // s2 - s1
+    subtract_Limbs(p3, p3, p2, pn);
+    divide_by_Limb(p3, p3, pn, 2);      // c3
+    subtract_multiplied_by_Limb(p2, p3, pn, 3); // c2
+    subtract_Limbs(p1, p1, p2, pn);
+    subtract_Limbs(p1, p1, p3, pn);     // c1
+
+    add_Into(r + k, rn - k, p1, get_NormalizedSize(p1, pn));
+    add_Into(r + 2 * k, rn - 2 * k, p2, get_NormalizedSize(p2, pn));
+    add_Into(r + 3 * k, rn - 3 * k, p3, get_NormalizedSize(p3, pn));
+}
+
+
+void multiply_Limbs(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn)
+{
+    if (a == b && an == bn)
+    {
+        square_Limbs(r, a, an);
+        return;
+    }
+
+    // Karatsuba recurses on (an + 1) / 2 + 1 limbs, which is less than an only starting from 4 limbs
+    if (bn < HugeInt::karatsuba_threshold || bn < 4)
+        multiply_Schoolbook(r, a, an, b, bn);
+    else if (bn >= HugeInt::ntt_threshold && is_NTT_Applicable(an, bn))
+        multiply_NTT(r, a, an, b, bn);
+    else if (bn >= HugeInt::toom3_threshold && bn > 2 * ((an + 2) / 3))
+        multiply_Toom3(r, a, an, b, bn);
+    else if (bn > (an + 1) / 2)
+        multiply_Karatsuba(r, a, an, b, bn);
+    else
+        multiply_Unbalanced(r, a, an, b, bn);
+}
+
+
+void square_Limbs(Limb *r, const Limb *a, size_t n)
+{
+    if (n < HugeInt::karatsuba_square_threshold || n < 4)
+        square_Schoolbook(r, a, n);
+    else if (n >= HugeInt::ntt_threshold && is_NTT_Applicable(n, n))
+        multiply_NTT(r, a, n, a, n);
+    else if (n >= HugeInt::toom3_threshold && n >= 5)
+        square_Toom3(r, a, n);
+    else
+        square_Karatsuba(r, a, n);
+}
+
+
+
+/**
+ * @brief Schoolbook division in place of 'u' (un limbs) by normalized 'v' (vn >= 2 limbs, highest bit set), un >= vn.
+ * q gets the low un - vn limbs of the quotient, the returned limb is its highest one (0 or 1). u[0..vn) is left with
+ * the remainder and the rest of u with zeros.
+ */
+static Limb divide_Normalized(Limb *q, Limb *u, size_t un, const Limb *v, size_t vn)
+{
+    Limb *u_top = u + un - vn;
+    Limb q_high = compare_Limbs(u_top, v, vn) >= 0;
+    if (q_high)
+        subtract_Limbs(u_top, u_top, v, vn);
+
+    // each quotient digit estimate is off by at most 2 since the highest bit of the divisor is set
+    Limb v_high = v[vn - 1], v_next = v[vn - 2];
+    for (size_t j = un - vn; j-- > 0;)
+    {
+        DoubleLimb numerator = (DoubleLimb(u[j + vn]) << LIMB_BITS) | u[j + vn - 1];
+        DoubleLimb q_hat = numerator / v_high;
+        DoubleLimb r_hat = numerator % v_high;
+        while ((q_hat >> LIMB_BITS) || q_hat * v_next > ((r_hat << LIMB_BITS) | u[j + vn - 2]))
+        {
+            --q_hat;
+            r_hat += v_high;
+            if (r_hat >> LIMB_BITS)
+                break;
+        }
+
+        Limb borrow = subtract_multiplied_by_Limb(u + j, v, vn, Limb(q_hat));
+        Limb u_top = u[j + vn];
+        u[j + vn] = u_top - borrow;
+        if (u_top < borrow)
+        {
+            // q_hat was still one too large
+            --q_hat;
+            u[j + vn] += add_Limbs(u + j, u + j, v, vn);
+        }
+        q[j] = Limb(q_hat);
+    }
+    return q_high;
+}
+
+
+static Limb divide_Recursive(Limb *q, Limb *u, const Limb *v, size_t n);
+
+/**
+ * @brief Division in place of 'u' (n + k limbs) by normalized 'v' (n limbs), k <= n. Same results as of divide_Normalized.
+ *
+ * The top 2k limbs of u are divided by the top k limbs of v recursively. The quotient they give is at most 2 more than
+ * the actual one, which is fixed by subtracting its product with the rest of v and adding v back while it's negative.
+ */
+static Limb divide_Part(Limb *q, Limb *u, const Limb *v, size_t n, size_t k)
+{
+    if (k < HugeInt::burnikel_ziegler_threshold)
+        return divide_Normalized(q, u, n + k, v, n);
+
+    Limb q_high = divide_Recursive(q, u + n - k, v + n - k, k);
+    if (k == n)
+        return q_high;
+
+    LimbBuffer product(n);
+    if (k >= n - k)
+        multiply_Limbs(product.data(), q, k, v, n - k);
+    else
+        multiply_Limbs(product.data(), v, n - k, q, k);
+
+    Limb borrow = subtract_Limbs(u, u, product.data(), n);
+    if (q_high)
+        borrow += subtract_Limbs(u + k, u + k, v, n - k);
+
+    static constexpr Limb one = 1;
+    while (borrow)
+    {
+        q_high -= subtract_From(q, k, &one, 1);
+        borrow -= add_Limbs(u, u, v, n);
+    }
+    return q_high;
+}
+
+
+/**
+ * @brief Burnikel-Ziegler division of 'u' (2n limbs) by normalized 'v' (n limbs), as two divisions of 3 halves by 2.
+ */
+static Limb divide_Recursive(Limb *q, Limb *u, const Limb *v, size_t n)
+{
+    size_t low = n / 2, high = n - low;
+    Limb q_high = divide_Part(q + low, u + low, v, n, high);
+    // the remainder is less than v now, so the lower half of the quotient can't overflow
+    divide_Part(q, u, v, n, low);
+    return q_high;
+}
+
+
+void divide_Schoolbook(Limb *q, Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn)
+{
+    if (bn == 1)
+    {
+        r[0] = divide_by_Limb(q, a, an, b[0]);
+        return;
+    }
+
+    // normalize so that the highest bit of the divisor is set, the extra limb of u keeps the quotient within an - bn + 1 limbs
+    unsigned shift = count_LeadingZeros(b[bn - 1]);
+    LimbBuffer buffer(an + 1 + bn);
+    Limb *u = buffer.data();
+    Limb *v = u + an + 1;
+    u[an] = shift_Left(u, a, an, shift);
+    shift_Left(v, b, bn, shift);
+
+    divide_Normalized(q, u, an + 1, v, bn);
+    shift_Right(r, u, bn, shift);
+}
+
+
+void divide_Limbs(Limb *q, Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn)
+{
+    if (bn < HugeInt::burnikel_ziegler_threshold || an - bn < HugeInt::burnikel_ziegler_threshold)
+    {
+        divide_Schoolbook(q, r, a, an, b, bn);
+        return;
+    }
+
+    unsigned shift = count_LeadingZeros(b[bn - 1]);
+    LimbBuffer buffer(an + 1 + bn);
+    Limb *u = buffer.data();
+    Limb *v = u + an + 1;
+    u[an] = shift_Left(u, a, an, shift);
+    shift_Left(v, b, bn, shift);
+
+    // quotient limbs are found in blocks of bn from the top, the first one takes the remainder of the division by bn,
+    // each block divides the current remainder followed by the next limbs of u
+    size_t qn = an - bn + 1;
+    size_t position = qn - qn % bn;
+    if (position < qn)
+        divide_Part(q + position, u + position, v, bn, qn - position);
+    while (position > 0)
+    {
+        position -= bn;
+        divide_Part(q + position, u + position, v, bn, bn);
+    }
+
+    shift_Right(r, u, bn, shift);
+}
+
+
+}
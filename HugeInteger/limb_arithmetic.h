@@ -0,0 +1,151 @@
+#ifndef __LIMB_ARITHMETIC__
+#define __LIMB_ARITHMETIC__
+
+
+#include <cstddef>
+#include <vector>
+#include <string>
+
+#include "huge_integer.h"
+
+
+
+/**
+ * Low level routines on little-endian arrays of unsigned base integers (limbs).
+ * Unlike HugeInt itself these know nothing about signs - all numbers here are non-negative magnitudes.
+ * Output arrays may alias the first input where it's stated, otherwise they must not overlap the inputs.
+ */
+namespace limbs
+{
+
+using Limb = HugeInt::BaseUint;
+using DoubleLimb = HugeInt::DoubleBaseUint;
+
+static constexpr size_t LIMB_BITS = sizeof(Limb) * 8;
+
+
+/**
+ * @brief r = a + b, where both a and b have n limbs. r may alias a or b. Returns the carry.
+ */
+Limb add_Limbs(Limb *r, const Limb *a, const Limb *b, size_t n);
+/**
+ * @brief r = a - b, where both a and b have n limbs. r may alias a or b. Returns the borrow.
+ */
+Limb subtract_Limbs(Limb *r, const Limb *a, const Limb *b, size_t n);
+/**
+ * @brief r[0..rn) += a[0..an), an <= rn, carry is propagated to the end of r. Returns the carry out of r.
+ */
+Limb add_Into(Limb *r, size_t rn, const Limb *a, size_t an);
+/**
+ * @brief r[0..rn) -= a[0..an), an <= rn, borrow is propagated to the end of r. Returns the borrow out of r.
+ */
+Limb subtract_From(Limb *r, size_t rn, const Limb *a, size_t an);
+
+/**
+ * @brief r = a * b, where a has n limbs. r may alias a. Returns the high limb of the product.
+ */
+Limb multiply_by_Limb(Limb *r, const Limb *a, size_t n, Limb b);
+/**
+ * @brief r += a * b, where both r and a have n limbs. Returns the carry limb.
+ */
+Limb add_multiplied_by_Limb(Limb *r, const Limb *a, size_t n, Limb b);
+/**
+ * @brief r -= a * b, where both r and a have n limbs. Returns the borrow limb.
+ */
+Limb subtract_multiplied_by_Limb(Limb *r, const Limb *a, size_t n, Limb b);
+/**
+ * @brief q = a / d, where a has n limbs. q may alias a. Returns the remainder.
+ */
+Limb divide_by_Limb(Limb *q, const Limb *a, size_t n, Limb d);
+
+/**
+ * @brief r = a << shift, where a has n limbs and 0 <= shift < LIMB_BITS. r may alias a or start above it (to shift
+ * by whole limbs in the same pass). Returns the bits shifted out.
+ */
+Limb shift_Left(Limb *r, const Limb *a, size_t n, unsigned shift);
+/**
+ * @brief r = a >> shift, where a has n limbs and 0 <= shift < LIMB_BITS. r may alias a or start below it. Returns
+ * the bits shifted out (in the high bits of the returned limb).
+ */
+Limb shift_Right(Limb *r, const Limb *a, size_t n, unsigned shift);
+/**
+ * @brief Number of leading zero bits of a non-zero limb.
+ */
+unsigned count_LeadingZeros(Limb x);
+/**
+ * @brief Number of trailing zero bits of a non-zero limb.
+ */
+unsigned count_TrailingZeros(Limb x);
+/**
+ * @brief Number of bits set in the n limbs of a.
+ */
+size_t count_SetBits(const Limb *a, size_t n);
+
+/**
+ * @brief Two's complement negation of n limbs in place.
+ */
+void negate_Limbs(Limb *a, size_t n);
+/**
+ * @brief Number of limbs without the leading zero ones.
+ */
+size_t get_NormalizedSize(const Limb *a, size_t n);
+/**
+ * @brief Compare a and b, both of n limbs. Returns -1, 0 or 1 as a is less than, equal to or greater than b.
+ */
+int compare_Limbs(const Limb *a, const Limb *b, size_t n);
+
+/**
+ * @brief r = a * b using schoolbook multiplication. r has an + bn limbs and must not overlap a or b.
+ */
+void multiply_Schoolbook(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn);
+/**
+ * @brief r = a * a using schoolbook squaring, which computes each of the symmetric products a[i] * a[j] once.
+ * r has 2n limbs and must not overlap a.
+ */
+void square_Schoolbook(Limb *r, const Limb *a, size_t n);
+/**
+ * @brief Whether multiply_NTT can compute the product of operands of these sizes exactly.
+ */
+bool is_NTT_Applicable(size_t an, size_t bn);
+/**
+ * @brief r = a * b using three-prime number theoretic transform with CRT recombination.
+ * r has an + bn limbs and must not overlap a or b. Requires is_NTT_Applicable(an, bn).
+ */
+void multiply_NTT(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn);
+/**
+ * @brief r = a * b, where an >= bn > 0. r has an + bn limbs and must not overlap a or b.
+ * Dispatches to schoolbook, Karatsuba, Toom-3 or NTT multiplication by the size of operands, or to square_Limbs
+ * if a and b are the same array.
+ */
+void multiply_Limbs(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn);
+/**
+ * @brief r = a * a, where n > 0. r has 2n limbs and must not overlap a.
+ * Same dispatch as of multiply_Limbs, but with squaring versions of the algorithms (NTT transforms a only once).
+ */
+void square_Limbs(Limb *r, const Limb *a, size_t n);
+
+/**
+ * @brief q = a / b, r = a % b using Knuth's algorithm D, where an >= bn > 0 and b[bn - 1] != 0.
+ * q has an - bn + 1 limbs, r has bn limbs, neither may overlap the inputs.
+ */
+void divide_Schoolbook(Limb *q, Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn);
+/**
+ * @brief q = a / b, r = a % b, where an >= bn > 0 and b[bn - 1] != 0.
+ * q has an - bn + 1 limbs, r has bn limbs, neither may overlap the inputs.
+ * Switches from schoolbook to Burnikel-Ziegler recursive division when both the divisor and the quotient are large.
+ */
+void divide_Limbs(Limb *q, Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn);
+
+/**
+ * @brief Convert a string of decimal digits (most significant first, no sign) to normalized limbs.
+ */
+std::vector<Limb> parse_Decimal(const char *digits, size_t num_digits);
+/**
+ * @brief Append decimal digits of x (without leading zeros, "0" for zero) to the string.
+ */
+void format_Decimal(std::string &result, const Limb *x, size_t xn);
+
+}
+
+
+#endif
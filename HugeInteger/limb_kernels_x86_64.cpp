@@ -0,0 +1,263 @@
+#include "limb_kernels_x86_64.h"
+
+
+#ifdef HUGE_INT_X86_64_KERNELS
+
+
+namespace limbs
+{
+namespace x86_64
+{
+
+
+bool has_MulxAdx()
+{
+    // may be called before the constructors of the runtime support library
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("adx");
+}
+
+
+bool has_Popcnt()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("popcnt");
+}
+
+
+/*
+ * The kernels below do the first n % 4 limbs in C++ and the rest in blocks of 4 by an assembly loop. The loop counter is
+ * kept in rcx and advanced by lea, then tested by jrcxz, as neither of them touches the flags with the carries in them.
+ */
+
+
+Limb add_Limbs(Limb *r, const Limb *a, const Limb *b, size_t n)
+{
+    Limb carry = 0;
+    size_t head = n % 4;
+    for (size_t i = 0; i < head; ++i)
+    {
+        DoubleLimb s = DoubleLimb(a[i]) + b[i] + carry;
+        r[i] = Limb(s);
+        carry = Limb(s >> LIMB_BITS);
+    }
+
+    size_t blocks = n / 4;
+    if (blocks == 0)
+        return carry;
+
+    a += head, b += head, r += head;
+    Limb t0, t1;
+    __asm__(
+        "neg %[carry]\n\t" // CF = carry
+        "1:\n\t"
+        "mov (%[a]), %[t0]\n\t"
+        "adc (%[b]), %[t0]\n\t"
+        "mov %[t0], (%[r])\n\t"
+        "mov 8(%[a]), %[t1]\n\t"
+        "adc 8(%[b]), %[t1]\n\t"
+        "mov %[t1], 8(%[r])\n\t"
+        "mov 16(%[a]), %[t0]\n\t"
+        "adc 16(%[b]), %[t0]\n\t"
+        "mov %[t0], 16(%[r])\n\t"
+        "mov 24(%[a]), %[t1]\n\t"
+        "adc 24(%[b]), %[t1]\n\t"
+        "mov %[t1], 24(%[r])\n\t"
+        "lea 32(%[a]), %[a]\n\t"
+        "lea 32(%[b]), %[b]\n\t"
+        "lea 32(%[r]), %[r]\n\t"
+        "lea -1(%[blocks]), %[blocks]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "setc %b[carry]\n\t"
+        "movzbl %b[carry], %k[carry]\n\t"
+        : [a] "+r"(a), [b] "+r"(b), [r] "+r"(r), [blocks] "+c"(blocks), [carry] "+q"(carry),
+          [t0] "=&r"(t0), [t1] "=&r"(t1)
+        :
+        : "cc", "memory");
+    return carry;
+}
+
+
+Limb subtract_Limbs(Limb *r, const Limb *a, const Limb *b, size_t n)
+{
+    Limb borrow = 0;
+    size_t head = n % 4;
+    for (size_t i = 0; i < head; ++i)
+    {
+        Limb a_i = a[i], b_i = b[i];
+        Limb d = a_i - b_i;
+        Limb next_borrow = a_i < b_i || d < borrow;
+        r[i] = d - borrow;
+        borrow = next_borrow;
+    }
+
+    size_t blocks = n / 4;
+    if (blocks == 0)
+        return borrow;
+
+    a += head, b += head, r += head;
+    Limb t0, t1;
+    __asm__(
+        "neg %[borrow]\n\t" // CF = borrow
+        "1:\n\t"
+        "mov (%[a]), %[t0]\n\t"
+        "sbb (%[b]), %[t0]\n\t"
+        "mov %[t0], (%[r])\n\t"
+        "mov 8(%[a]), %[t1]\n\t"
+        "sbb 8(%[b]), %[t1]\n\t"
+        "mov %[t1], 8(%[r])\n\t"
+        "mov 16(%[a]), %[t0]\n\t"
+        "sbb 16(%[b]), %[t0]\n\t"
+        "mov %[t0], 16(%[r])\n\t"
+        "mov 24(%[a]), %[t1]\n\t"
+        "sbb 24(%[b]), %[t1]\n\t"
+        "mov %[t1], 24(%[r])\n\t"
+        "lea 32(%[a]), %[a]\n\t"
+        "lea 32(%[b]), %[b]\n\t"
+        "lea 32(%[r]), %[r]\n\t"
+        "lea -1(%[blocks]), %[blocks]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "setc %b[borrow]\n\t"
+        "movzbl %b[borrow], %k[borrow]\n\t"
+        : [a] "+r"(a), [b] "+r"(b), [r] "+r"(r), [blocks] "+c"(blocks), [borrow] "+q"(borrow),
+          [t0] "=&r"(t0), [t1] "=&r"(t1)
+        :
+        : "cc", "memory");
+    return borrow;
+}
+
+
+__attribute__((target("bmi2,adx")))
+Limb multiply_by_Limb(Limb *r, const Limb *a, size_t n, Limb b)
+{
+    Limb carry = 0;
+    size_t head = n % 4;
+    for (size_t i = 0; i < head; ++i)
+    {
+        DoubleLimb p = DoubleLimb(a[i]) * b + carry;
+        r[i] = Limb(p);
+        carry = Limb(p >> LIMB_BITS);
+    }
+
+    size_t blocks = n / 4;
+    if (blocks == 0)
+        return carry;
+
+    // low halves of the products plus the high halves of the previous ones in the CF chain
+    a += head, r += head;
+    Limb low0, high0, low1, high1;
+    __asm__(
+        "xor %k[low0], %k[low0]\n\t" // CF = 0
+        "1:\n\t"
+        "mulx (%[a]), %[low0], %[high0]\n\t"
+        "adcx %[carry], %[low0]\n\t"
+        "mov %[low0], (%[r])\n\t"
+        "mulx 8(%[a]), %[low1], %[high1]\n\t"
+        "adcx %[high0], %[low1]\n\t"
+        "mov %[low1], 8(%[r])\n\t"
+        "mulx 16(%[a]), %[low0], %[high0]\n\t"
+        "adcx %[high1], %[low0]\n\t"
+        "mov %[low0], 16(%[r])\n\t"
+        "mulx 24(%[a]), %[low1], %[carry]\n\t"
+        "adcx %[high0], %[low1]\n\t"
+        "mov %[low1], 24(%[r])\n\t"
+        "lea 32(%[a]), %[a]\n\t"
+        "lea 32(%[r]), %[r]\n\t"
+        "lea -1(%[blocks]), %[blocks]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %k[low0]\n\t"
+        "adcx %[low0], %[carry]\n\t"
+        : [a] "+r"(a), [r] "+r"(r), [blocks] "+c"(blocks), [carry] "+r"(carry),
+          [low0] "=&r"(low0), [high0] "=&r"(high0), [low1] "=&r"(low1), [high1] "=&r"(high1)
+        : "d"(b)
+        : "cc", "memory");
+    return carry;
+}
+
+
+__attribute__((target("bmi2,adx")))
+Limb add_multiplied_by_Limb(Limb *r, const Limb *a, size_t n, Limb b)
+{
+    Limb carry = 0;
+    size_t head = n % 4;
+    for (size_t i = 0; i < head; ++i)
+    {
+        DoubleLimb p = DoubleLimb(a[i]) * b + r[i] + carry;
+        r[i] = Limb(p);
+        carry = Limb(p >> LIMB_BITS);
+    }
+
+    size_t blocks = n / 4;
+    if (blocks == 0)
+        return carry;
+
+    // two independent carry chains: the products in CF (adcx) and their sum with r in OF (adox)
+    a += head, r += head;
+    Limb low0, high0, low1, high1;
+    __asm__(
+        "xor %k[low0], %k[low0]\n\t" // CF = OF = 0
+        "1:\n\t"
+        "mulx (%[a]), %[low0], %[high0]\n\t"
+        "adcx %[carry], %[low0]\n\t"
+        "adox (%[r]), %[low0]\n\t"
+        "mov %[low0], (%[r])\n\t"
+        "mulx 8(%[a]), %[low1], %[high1]\n\t"
+        "adcx %[high0], %[low1]\n\t"
+        "adox 8(%[r]), %[low1]\n\t"
+        "mov %[low1], 8(%[r])\n\t"
+        "mulx 16(%[a]), %[low0], %[high0]\n\t"
+        "adcx %[high1], %[low0]\n\t"
+        "adox 16(%[r]), %[low0]\n\t"
+        "mov %[low0], 16(%[r])\n\t"
+        "mulx 24(%[a]), %[low1], %[carry]\n\t"
+        "adcx %[high0], %[low1]\n\t"
+        "adox 24(%[r]), %[low1]\n\t"
+        "mov %[low1], 24(%[r])\n\t"
+        "lea 32(%[a]), %[a]\n\t"
+        "lea 32(%[r]), %[r]\n\t"
+        "lea -1(%[blocks]), %[blocks]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        // the final sum is less than 2^128, so neither of the last carries overloads the high limb
+        "mov $0, %k[low0]\n\t"
+        "adcx %[low0], %[carry]\n\t"
+        "adox %[low0], %[carry]\n\t"
+        : [a] "+r"(a), [r] "+r"(r), [blocks] "+c"(blocks), [carry] "+r"(carry),
+          [low0] "=&r"(low0), [high0] "=&r"(high0), [low1] "=&r"(low1), [high1] "=&r"(high1)
+        : "d"(b)
+        : "cc", "memory");
+    return carry;
+}
+
+
+__attribute__((target("popcnt")))
+size_t count_SetBits(const Limb *a, size_t n)
+{
+    // without the target the builtin is a library call per limb; four sums keep popcnt busy despite its latency
+    size_t count0 = 0, count1 = 0, count2 = 0, count3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        count0 += __builtin_popcountll(a[i]);
+        count1 += __builtin_popcountll(a[i + 1]);
+        count2 += __builtin_popcountll(a[i + 2]);
+        count3 += __builtin_popcountll(a[i + 3]);
+    }
+    for (; i < n; ++i)
+        count0 += __builtin_popcountll(a[i]);
+    return count0 + count1 + count2 + count3;
+}
+
+
+}
+}
+
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __LIMB_KERNELS_X86_64__
+#define __LIMB_KERNELS_X86_64__
+
+
+#include "limb_arithmetic.h"
+
+
+// Hand written x86-64 kernels are used for 64-bit limbs with GCC compatible compilers, unless disabled
+#if defined(__x86_64__) && defined(__GNUC__) && HUGE_INT_BASE_BITS == 64 && !defined(HUGE_INT_NO_ASM_KERNELS)
+#define HUGE_INT_X86_64_KERNELS
+
+
+/**
+ * Carry chain kernels of limb_arithmetic.h in x86-64 assembly, unrolled by 4 limbs.
+ * Compilers don't keep the carry in the flags across iterations of a loop on unsigned __int128, and can't interleave
+ * two carry chains at all, which the ADX instructions are made for.
+ */
+namespace limbs
+{
+namespace x86_64
+{
+
+/**
+ * @brief Whether the CPU has the BMI2 (mulx) and ADX (adcx, adox) instructions the multiplication kernels need.
+ */
+bool has_MulxAdx();
+/**
+ * @brief Whether the CPU has the popcnt instruction.
+ */
+bool has_Popcnt();
+
+// Same as their portable counterparts, need only the base x86-64 instructions.
+Limb add_Limbs(Limb *r, const Limb *a, const Limb *b, size_t n);
+Limb subtract_Limbs(Limb *r, const Limb *a, const Limb *b, size_t n);
+
+// Same as their portable counterparts, need has_MulxAdx().
+Limb multiply_by_Limb(Limb *r, const Limb *a, size_t n, Limb b);
+Limb add_multiplied_by_Limb(Limb *r, const Limb *a, size_t n, Limb b);
+
+// Same as its portable counterpart, needs has_Popcnt(). Plain C++ compiled for the popcnt instruction.
+size_t count_SetBits(const Limb *a, size_t n);
+
+}
+}
+
+
+#endif
+
+
+#endif
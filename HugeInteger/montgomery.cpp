@@ -0,0 +1,167 @@
+#include "montgomery.h"
+#include "limb_arithmetic.h"
+#include "limb_allocator.h"
+#include <stdexcept>
+#include <algorithm>
+
+
+
+using limbs::LIMB_BITS;
+
+
+/**
+ * @brief Width of the sliding window for an exponent of this many bits. Wider windows mean fewer multiplications
+ * but a larger table of odd powers to precompute (2^(bits - 1) multiplications).
+ */
+static unsigned get_WindowBits(size_t exponent_bits)
+{
+    if (exponent_bits > 671)
+        return 6;
+    if (exponent_bits > 239)
+        return 5;
+    if (exponent_bits > 79)
+        return 4;
+    if (exponent_bits > 23)
+        return 3;
+    return 1;
+}
+
+
+MontgomeryContext::MontgomeryContext(const HugeInt &modulus) : modulus(modulus)
+{
+    HugeInt buffer(0);
+    size_t n;
+    const BaseUint *m = modulus.get_Magnitude(buffer, n);
+    if (modulus.is_Negative() || n == 0 || !(m[0] & 1))
+        throw std::domain_error("Montgomery modulus must be positive and odd.");
+    modulus_limbs.assign(m, m + n);
+
+    // Newton's iteration x = x * (2 - m * x) doubles the number of correct low bits of m^(-1),
+    // and m * m = 1 mod 8 for any odd m gives the first 3 of them
+    BaseUint x = m[0];
+    for (int i = 0; i < 5; ++i)
+        x *= BaseUint(2 - m[0] * x);
+    inverse = BaseUint(0 - x);
+
+    // R^2 = 2^(2 * n * LIMB_BITS)
+    std::vector<BaseUint> power(2 * n + 1, 0), quotient(n + 2);
+    power[2 * n] = 1;
+    r_squared.resize(n);
+    limbs::divide_Limbs(quotient.data(), r_squared.data(), power.data(), power.size(), m, n);
+}
+
+
+void MontgomeryContext::reduce(BaseUint *r, BaseUint *t) const
+{
+    size_t n = get_Size();
+    const BaseUint *m = modulus_limbs.data();
+
+    // add such multiples of the modulus that zero t from the bottom one base integer at a time
+    BaseUint carry = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        BaseUint high = limbs::add_multiplied_by_Limb(t + i, m, n, BaseUint(t[i] * inverse));
+        HugeInt::DoubleBaseUint s = HugeInt::DoubleBaseUint(t[i + n]) + high + carry;
+        t[i + n] = BaseUint(s);
+        carry = BaseUint(s >> LIMB_BITS);
+    }
+
+    // what's left is less than 2 * modulus
+    if (carry || limbs::compare_Limbs(t + n, m, n) >= 0)
+        limbs::subtract_Limbs(r, t + n, m, n);
+    else
+        std::copy(t + n, t + 2 * n, r);
+}
+
+
+void MontgomeryContext::multiply(BaseUint *r, const BaseUint *a, const BaseUint *b, BaseUint *t) const
+{
+    size_t n = get_Size();
+    limbs::multiply_Limbs(t, a, n, b, n);
+    reduce(r, t);
+}
+
+
+HugeInt MontgomeryContext::pow_Mod(const HugeInt &base, const HugeInt &exponent) const
+{
+    if (exponent.is_Negative())
+        throw std::domain_error("Exponent of the modular power must not be negative.");
+
+    HugeInt exponent_buffer(0);
+    size_t exponent_size;
+    const BaseUint *e = exponent.get_Magnitude(exponent_buffer, exponent_size);
+    if (exponent_size == 0)
+        return HugeInt(1) % modulus;
+
+    size_t n = get_Size();
+    size_t exponent_bits = exponent_size * LIMB_BITS - limbs::count_LeadingZeros(e[exponent_size - 1]);
+    unsigned window_bits = get_WindowBits(exponent_bits);
+    size_t table_size = size_t(1) << (window_bits - 1);
+
+    // odd powers base^1, base^3, ..., base^(2 * table_size - 1), result, scratch of 2n and base^2
+    LimbBuffer buffer((table_size + 4) * n);
+    BaseUint *table = buffer.data();
+    BaseUint *result = table + table_size * n;
+    BaseUint *t = result + n;
+    BaseUint *base_squared = t + 2 * n;
+
+    HugeInt reduced_base = base % modulus;
+    if (reduced_base.is_Negative())
+        reduced_base += modulus;
+    const BaseUint *base_data = reduced_base.get_BaseUints();
+    size_t base_size = std::min(reduced_base.size, n);
+    std::copy(base_data, base_data + base_size, result);
+    std::fill(result + base_size, result + n, 0);
+
+    multiply(table, result, r_squared.data(), t);
+    multiply(base_squared, table, table, t);
+    for (size_t i = 1; i < table_size; ++i)
+        multiply(table + i * n, table + (i - 1) * n, base_squared, t);
+
+    // left to right over the exponent, every window starts and ends with a set bit, so it's an odd power from the table
+    auto get_Bit = [e](size_t i) { return (e[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1; };
+    bool started = false;
+    for (size_t i = exponent_bits; i > 0;)
+    {
+        if (!get_Bit(i - 1))
+        {
+            multiply(result, result, result, t);
+            --i;
+            continue;
+        }
+
+        size_t low = i > window_bits ? i - window_bits : 0;
+        while (!get_Bit(low))
+            ++low;
+        size_t window = 0;
+        for (size_t j = i; j-- > low;)
+            window = (window << 1) | get_Bit(j);
+
+        const BaseUint *odd_power = table + (window >> 1) * n;
+        if (started)
+        {
+            for (size_t j = low; j < i; ++j)
+                multiply(result, result, result, t);
+            multiply(result, result, odd_power, t);
+        }
+        else
+        {
+            std::copy(odd_power, odd_power + n, result);
+            started = true;
+        }
+        i = low;
+    }
+
+    // out of the Montgomery form
+    std::copy(result, result + n, t);
+    std::fill(t + n, t + 2 * n, 0);
+    reduce(result, t);
+
+    // one more integer for the sign bit if the highest bit of the value is set
+    size_t size = std::max<size_t>(limbs::get_NormalizedSize(result, n), 1);
+    HugeInt power(size + 1, 0);
+    std::copy(result, result + size, power.get_BaseUints());
+    if (!(result[size - 1] >> (LIMB_BITS - 1)))
+        power.size = size;
+    return power;
+}
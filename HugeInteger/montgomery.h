@@ -0,0 +1,67 @@
+#ifndef __MONTGOMERY__
+#define __MONTGOMERY__
+
+
+#include <cstddef>
+#include <vector>
+
+#include "huge_integer.h"
+
+
+
+/**
+ * Modular exponentiation by a fixed odd modulus using Montgomery multiplication.
+ * The values are kept multiplied by R = 2^(modulus size in bits rounded up to base integers), which turns every
+ * reduction modulo the modulus into a multiplication and a shift. Things depending only on the modulus are computed
+ * once in the constructor, so a context should be reused for all the exponentiations with the same modulus.
+ */
+class MontgomeryContext
+{
+public:
+    using BaseUint = HugeInt::BaseUint;
+
+private:
+    HugeInt modulus;
+    // magnitude of the modulus without leading zeros, n base integers
+    std::vector<BaseUint> modulus_limbs;
+    // R^2 mod modulus, n base integers, for conversion to the Montgomery form
+    std::vector<BaseUint> r_squared;
+    // -modulus^(-1) mod 2^(bits of BaseUint)
+    BaseUint inverse;
+
+public:
+    /**
+     * @brief Precompute everything for the modulus. Throws std::domain_error unless it's positive and odd.
+     */
+    explicit MontgomeryContext(const HugeInt &modulus);
+
+    const HugeInt &get_Modulus() const
+    {
+        return modulus;
+    }
+
+    /**
+     * @brief base^exponent mod modulus in [0, modulus). Any base, negative ones included.
+     * Throws std::domain_error if the exponent is negative.
+     */
+    HugeInt pow_Mod(const HugeInt &base, const HugeInt &exponent) const;
+
+private:
+    size_t get_Size() const
+    {
+        return modulus_limbs.size();
+    }
+
+    /**
+     * @brief r = t * R^(-1) mod modulus, where t has 2n base integers (and is overwritten) and is less than modulus * R.
+     * r has n base integers.
+     */
+    void reduce(BaseUint *r, BaseUint *t) const;
+    /**
+     * @brief r = a * b * R^(-1) mod modulus, all of n base integers, 't' is scratch of 2n ones. r may alias a or b.
+     */
+    void multiply(BaseUint *r, const BaseUint *a, const BaseUint *b, BaseUint *t) const;
+};
+
+
+#endif
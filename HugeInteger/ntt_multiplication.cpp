@@ -0,0 +1,240 @@
+#include "limb_arithmetic.h"
+#include "parallel_tasks.h"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+
+
+/**
+ * Multiplication via number theoretic transform (NTT) - FFT over the prime field Z/pZ instead of complex numbers,
+ * so it's exact. Operands are split into 32-bit digits, which are convolved modulo three primes separately and the
+ * exact convolution is then restored by the Chinese remainder theorem.
+ */
+namespace limbs
+{
+
+
+namespace
+{
+
+using Digit = uint32_t;
+static constexpr size_t DIGIT_BITS = 32;
+static constexpr size_t DIGITS_PER_LIMB = LIMB_BITS / DIGIT_BITS;
+
+using uint128_t = unsigned __int128;
+
+
+constexpr uint32_t power_Mod(uint32_t base, uint64_t exp, uint32_t mod)
+{
+    uint64_t result = 1, b = base % mod;
+    for (; exp > 0; exp >>= 1)
+    {
+        if (exp & 1)
+            result = result * b % mod;
+        b = b * b % mod;
+    }
+    return uint32_t(result);
+}
+
+
+/**
+ * @brief Arithmetic and transform over Z/PZ, where P = c * 2^k + 1 < 2^31 and G is a primitive root modulo P.
+ */
+template <uint32_t P, uint32_t G>
+struct PrimeField
+{
+    static constexpr uint32_t MODULUS = P;
+
+    static inline uint32_t add(uint32_t a, uint32_t b)
+    {
+        uint32_t s = a + b;
+        return s >= P ? s - P : s;
+    }
+
+    static inline uint32_t subtract(uint32_t a, uint32_t b)
+    {
+        return a >= b ? a - b : a + P - b;
+    }
+
+    static inline uint32_t multiply(uint32_t a, uint32_t b)
+    {
+        return uint32_t(uint64_t(a) * b % P);
+    }
+
+    /**
+     * @brief In place iterative radix-2 transform of a power of 2 sized array. Inverse one includes the division by size.
+     * Butterflies of each level are split between the threads of the budget on large arrays.
+     */
+    static void transform(uint32_t *a, size_t n, bool inverse)
+    {
+        for (size_t i = 1, j = 0; i < n; ++i)
+        {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
+            j ^= bit;
+            if (i < j)
+                std::swap(a[i], a[j]);
+        }
+
+        std::vector<uint32_t> roots(n / 2);
+        for (size_t len = 2; len <= n; len <<= 1)
+        {
+            size_t half = len / 2;
+            uint32_t root = power_Mod(G, (P - 1) / len, P);
+            if (inverse)
+                root = power_Mod(root, P - 2, P);
+
+            roots[0] = 1;
+            for (size_t k = 1; k < half; ++k)
+                roots[k] = multiply(roots[k - 1], root);
+
+            // butterfly t of the level is the k-th one of the block starting at i
+            auto do_Butterflies = [&](size_t begin, size_t end)
+            {
+                size_t i = begin / half * len, k = begin % half;
+                for (size_t t = begin; t < end; ++t)
+                {
+                    uint32_t u = a[i + k];
+                    uint32_t v = multiply(a[i + k + half], roots[k]);
+                    a[i + k] = add(u, v);
+                    a[i + k + half] = subtract(u, v);
+                    if (++k == half)
+                    {
+                        k = 0;
+                        i += len;
+                    }
+                }
+            };
+            if (is_Parallel(n / DIGITS_PER_LIMB))
+                run_ParallelFor(n / 2, do_Butterflies);
+            else
+                do_Butterflies(0, n / 2);
+        }
+
+        if (inverse)
+        {
+            uint32_t n_inverse = power_Mod(uint32_t(n % P), P - 2, P);
+            for (size_t i = 0; i < n; ++i)
+                a[i] = multiply(a[i], n_inverse);
+        }
+    }
+
+    /**
+     * @brief result = (a * b) mod P in the digit-wise convolution sense. 'b_buffer' is a scratch array of size n.
+     * Squaring (the same a and b) takes one forward transform instead of two.
+     */
+    static void convolve(uint32_t *result, const Limb *a, size_t an, const Limb *b, size_t bn,
+                         uint32_t *b_buffer, size_t n)
+    {
+        load_Digits(result, a, an, n);
+        transform(result, n, false);
+        if (a == b && an == bn)
+        {
+            for (size_t i = 0; i < n; ++i)
+                result[i] = multiply(result[i], result[i]);
+        }
+        else
+        {
+            load_Digits(b_buffer, b, bn, n);
+            transform(b_buffer, n, false);
+            for (size_t i = 0; i < n; ++i)
+                result[i] = multiply(result[i], b_buffer[i]);
+        }
+        transform(result, n, true);
+    }
+
+    static void load_Digits(uint32_t *digits, const Limb *x, size_t xn, size_t n)
+    {
+        size_t num_digits = xn * DIGITS_PER_LIMB;
+        for (size_t i = 0; i < num_digits; ++i)
+            digits[i] = Digit(x[i / DIGITS_PER_LIMB] >> (DIGIT_BITS * (i % DIGITS_PER_LIMB))) % P;
+        std::fill(digits + num_digits, digits + n, 0);
+    }
+};
+
+
+// All three allow transforms up to 2^25 points
+using Field1 = PrimeField<167772161, 3>;   // 5 * 2^25 + 1
+using Field2 = PrimeField<469762049, 3>;   // 7 * 2^26 + 1
+using Field3 = PrimeField<2013265921, 31>; // 15 * 2^27 + 1
+
+static constexpr size_t MAX_TRANSFORM_SIZE = size_t(1) << 25;
+
+static constexpr uint64_t P1 = Field1::MODULUS;
+static constexpr uint64_t P2 = Field2::MODULUS;
+static constexpr uint64_t P3 = Field3::MODULUS;
+static constexpr uint32_t P1_INVERSE_MOD_P2 = power_Mod(P1, P2 - 2, P2);
+static constexpr uint32_t P1P2_INVERSE_MOD_P3 = power_Mod((P1 * P2) % P3, P3 - 2, P3);
+
+// Each convolution term is a sum of at most min(da, db) products of two digits and has to be less than P1 * P2 * P3
+static constexpr uint128_t MAX_DIGIT_PRODUCT = uint128_t(Digit(~0)) * Digit(~0);
+static constexpr size_t MAX_CONVOLVED_DIGITS = size_t(uint128_t(P1) * P2 * P3 / MAX_DIGIT_PRODUCT);
+
+
+size_t get_TransformSize(size_t an, size_t bn)
+{
+    size_t num_digits = (an + bn) * DIGITS_PER_LIMB - 1;
+    size_t n = 1;
+    while (n < num_digits)
+        n <<= 1;
+    return n;
+}
+
+
+/**
+ * @brief Restore the exact convolution term from its residues modulo P1, P2 and P3.
+ */
+inline uint128_t restore_CRT(uint32_t r1, uint32_t r2, uint32_t r3)
+{
+    uint64_t t = Field2::multiply(Field2::subtract(r2, r1), P1_INVERSE_MOD_P2);
+    uint64_t x12 = r1 + P1 * t;
+    t = Field3::multiply(Field3::subtract(r3, uint32_t(x12 % P3)), P1P2_INVERSE_MOD_P3);
+    return x12 + uint128_t(P1 * P2) * t;
+}
+
+}
+
+
+bool is_NTT_Applicable(size_t an, size_t bn)
+{
+    return get_TransformSize(an, bn) <= MAX_TRANSFORM_SIZE
+        && std::min(an, bn) * DIGITS_PER_LIMB <= MAX_CONVOLVED_DIGITS;
+}
+
+
+void multiply_NTT(Limb *r, const Limb *a, size_t an, const Limb *b, size_t bn)
+{
+    size_t n = get_TransformSize(an, bn);
+    // the convolutions by the three primes are independent, in parallel each of them needs its own scratch
+    bool squaring = a == b && an == bn;
+    bool parallel = is_Parallel(an + bn);
+    size_t num_b_buffers = squaring ? 0 : parallel ? 3 : 1;
+    std::vector<uint32_t> buffer((3 + num_b_buffers) * n);
+    uint32_t *residues1 = buffer.data();
+    uint32_t *residues2 = residues1 + n;
+    uint32_t *residues3 = residues2 + n;
+    uint32_t *b_buffers[3];
+    for (size_t i = 0; i < 3; ++i)
+        b_buffers[i] = residues3 + n + (num_b_buffers == 3 ? i * n : 0);
+
+    run_Tasks(an + bn,
+              [&] { Field1::convolve(residues1, a, an, b, bn, b_buffers[0], n); },
+              [&] { Field2::convolve(residues2, a, an, b, bn, b_buffers[1], n); },
+              [&] { Field3::convolve(residues3, a, an, b, bn, b_buffers[2], n); });
+
+    size_t rn = an + bn;
+    std::fill(r, r + rn, 0);
+    uint128_t carry = 0;
+    for (size_t i = 0; i < rn * DIGITS_PER_LIMB; ++i)
+    {
+        if (i < n)
+            carry += restore_CRT(residues1[i], residues2[i], residues3[i]);
+        r[i / DIGITS_PER_LIMB] |= Limb(Digit(carry)) << (DIGIT_BITS * (i % DIGITS_PER_LIMB));
+        carry >>= DIGIT_BITS;
+    }
+}
+
+
+}
@@ -0,0 +1,314 @@
+#include "huge_integer.h"
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+
+
+
+static constexpr size_t BASE_UINT_BITS = sizeof(HugeInt::BaseUint) * 8;
+
+
+/**
+ * Every step of the Euclidean algorithm subtracts a multiple of one number of the pair from the other, so a sequence
+ * of them is a matrix M with (a; b) = M (a'; b') for the initial pair (a, b) and the reduced one (a', b'). Its entries
+ * are non-negative and its determinant is 1, so gcd(a', b') = gcd(a, b), and M^-1 = (m22 -m12; -m21 m11) applies the
+ * same reduction to any other pair.
+ *
+ * A reduction that keeps both numbers above 2^s has entries below 2^(n - s) for numbers of n bits. Reducing the leading
+ * bits of a pair, above 2^p, that way to above 2^s with s > (n - p) / 2 makes a matrix that keeps the whole pair
+ * positive and above 2^(p + s - 1). That's how a Lehmer step reduces large numbers by their leading bits only, and how
+ * the half-GCD reduces numbers of n bits by half of them through two reductions of n / 2 bits.
+ */
+struct HugeInt::ReductionMatrix
+{
+    HugeInt m11 = 1, m12 = 0, m21 = 0, m22 = 1;
+
+    bool is_Identity() const
+    {
+        return m12 == 0 && m21 == 0;
+    }
+
+    // a' = a' - q b'
+    void subtract_FromFirst(const HugeInt &q)
+    {
+        m12 += q * m11;
+        m22 += q * m21;
+    }
+
+    // b' = b' - q a'
+    void subtract_FromSecond(const HugeInt &q)
+    {
+        m11 += q * m12;
+        m21 += q * m22;
+    }
+
+    // This reduction followed by the other one.
+    void append(const ReductionMatrix &other)
+    {
+        HugeInt n11 = m11 * other.m11 + m12 * other.m21;
+        HugeInt n12 = m11 * other.m12 + m12 * other.m22;
+        HugeInt n21 = m21 * other.m11 + m22 * other.m21;
+        m22 = m21 * other.m12 + m22 * other.m22;
+        m11 = std::move(n11);
+        m12 = std::move(n12);
+        m21 = std::move(n21);
+    }
+};
+
+
+bool HugeInt::reduce_Step(HugeInt &a, HugeInt &b, const HugeInt &bound, ReductionMatrix *m)
+{
+    bool is_a_larger = a >= b;
+    HugeInt &larger = is_a_larger ? a : b;
+    const HugeInt &smaller = is_a_larger ? b : a;
+
+    // larger - q * smaller > bound for q up to (larger - bound - 1) / smaller
+    HugeInt q(0), remainder(0);
+    divmod(larger - bound - 1, smaller, q, remainder);
+    if (q == 0)
+        return false;
+    larger = remainder + bound + 1;
+
+    if (m)
+        is_a_larger ? m->subtract_FromFirst(q) : m->subtract_FromSecond(q);
+    return true;
+}
+
+
+bool HugeInt::reduce_Lehmer(HugeInt &a, HugeInt &b, size_t threshold, ReductionMatrix *m)
+{
+    // leading bits are reduced in double base integers, two bits short of them so that the entries fit in BaseInt
+    static constexpr size_t top_bits = 2 * BASE_UINT_BITS - 2;
+    auto get_Bits = [](const HugeInt &x, size_t position)
+    {
+        size_t i = position / BASE_UINT_BITS;
+        unsigned shift = position % BASE_UINT_BITS;
+        DoubleBaseUint bits = (DoubleBaseUint(x.get_BaseUint(i + 1)) << BASE_UINT_BITS) | x.get_BaseUint(i);
+        if (shift)
+            bits = (bits >> shift) | (DoubleBaseUint(x.get_BaseUint(i + 2)) << (2 * BASE_UINT_BITS - shift));
+        return bits;
+    };
+
+    HugeInt bound = HugeInt(1) << threshold;
+    HugeInt next_a(0), next_b(0);
+    bool is_reduced = false;
+    while (true)
+    {
+        size_t n = std::max(a.get_BitLength(), b.get_BitLength());
+        size_t position = n > top_bits ? n - top_bits : 0;
+        size_t top_threshold = std::max(top_bits / 2 + 1, threshold + 1 - std::min(position, threshold + 1));
+        DoubleBaseUint top_a = get_Bits(a, position), top_b = get_Bits(b, position);
+
+        DoubleBaseUint u11 = 1, u12 = 0, u21 = 0, u22 = 1;
+        if (top_threshold < top_bits)
+        {
+            DoubleBaseUint top_bound = DoubleBaseUint(1) << top_threshold;
+            while (std::min(top_a, top_b) > top_bound)
+            {
+                if (top_a >= top_b)
+                {
+                    if (top_a - top_b <= top_bound)
+                        break;
+                    DoubleBaseUint q = (top_a - top_bound - 1) / top_b;
+                    top_a -= q * top_b;
+                    u12 += q * u11;
+                    u22 += q * u21;
+                }
+                else
+                {
+                    if (top_b - top_a <= top_bound)
+                        break;
+                    DoubleBaseUint q = (top_b - top_bound - 1) / top_a;
+                    top_b -= q * top_a;
+                    u11 += q * u12;
+                    u21 += q * u22;
+                }
+            }
+        }
+
+        if (u12 == 0 && u21 == 0)
+        {
+            // the leading bits don't tell enough, a whole division does
+            if (!reduce_Step(a, b, bound, m))
+                return is_reduced;
+            is_reduced = true;
+            continue;
+        }
+
+        ReductionMatrix u;
+        u.m11 = HugeInt(BaseInt(u11));
+        u.m12 = HugeInt(BaseInt(u12));
+        u.m21 = HugeInt(BaseInt(u21));
+        u.m22 = HugeInt(BaseInt(u22));
+        next_a = a * u.m22 - b * u.m12;
+        next_b = b * u.m11 - a * u.m21;
+        std::swap(a, next_a);
+        std::swap(b, next_b);
+        if (m)
+            m->append(u);
+        is_reduced = true;
+    }
+}
+
+
+bool HugeInt::reduce_Top(HugeInt &a, HugeInt &b, size_t position, ReductionMatrix *m)
+{
+    HugeInt top_a = a >> position, top_b = b >> position;
+    size_t top_threshold = std::max(top_a.get_BitLength(), top_b.get_BitLength()) / 2 + 1;
+    if (std::min(top_a, top_b) <= HugeInt(1) << top_threshold)
+        return false;
+
+    // a = 2^position top_a + low_a, the same for b
+    HugeInt low_a = a - (top_a << position), low_b = b - (top_b << position);
+    ReductionMatrix top_m;
+    if (!reduce_HalfGCD(top_a, top_b, top_threshold, &top_m))
+        return false;
+
+    // M^-1 (a; b) = 2^position M^-1 (top_a; top_b) + M^-1 (low_a; low_b), only the low parts are multiplied
+    a = (top_a << position) + top_m.m22 * low_a - top_m.m12 * low_b;
+    b = (top_b << position) + top_m.m11 * low_b - top_m.m21 * low_a;
+    if (m)
+        m->append(top_m);
+    return true;
+}
+
+
+bool HugeInt::reduce_HalfGCD(HugeInt &a, HugeInt &b, size_t threshold, ReductionMatrix *m)
+{
+    size_t n = std::max(a.get_BitLength(), b.get_BitLength());
+    if (n - threshold < half_gcd_threshold * BASE_UINT_BITS)
+        return reduce_Lehmer(a, b, threshold, m);
+
+    // the bits above the threshold by their leading half, which leaves about 3/4 of them
+    HugeInt bound = HugeInt(1) << threshold;
+    bool is_reduced = reduce_Top(a, b, threshold, m);
+    if (!reduce_Step(a, b, bound, m))
+        return is_reduced;
+
+    // the rest of them by the leading bits that reduce to just above the threshold
+    n = std::max(a.get_BitLength(), b.get_BitLength());
+    reduce_Top(a, b, 2 * threshold + 1 > n ? 2 * threshold + 1 - n : 0, m);
+    while (reduce_Step(a, b, bound, m))
+        ;
+    return true;
+}
+
+
+void HugeInt::reduce_Euclid(HugeInt &a, HugeInt &b, ReductionMatrix *m)
+{
+    HugeInt q(0);
+    while (a != 0 && b != 0)
+    {
+        // numbers of about the same size are halved, others get there by a division
+        size_t a_bits = a.get_BitLength(), b_bits = b.get_BitLength();
+        size_t n = std::max(a_bits, b_bits), k = std::min(a_bits, b_bits);
+        if (n - k < BASE_UINT_BITS && k > 2 * BASE_UINT_BITS && reduce_HalfGCD(a, b, n / 2, m))
+            continue;
+
+        bool is_a_larger = a >= b;
+        HugeInt &larger = is_a_larger ? a : b;
+        divmod(larger, is_a_larger ? b : a, q, larger);
+        if (m)
+            is_a_larger ? m->subtract_FromFirst(q) : m->subtract_FromSecond(q);
+    }
+}
+
+
+HugeInt HugeInt::gcd(const HugeInt &a, const HugeInt &b)
+{
+    HugeInt x = a.is_Negative() ? HugeInt(-a) : a;
+    HugeInt y = b.is_Negative() ? HugeInt(-b) : b;
+    reduce_Euclid(x, y, nullptr);
+    return x == 0 ? y : x;
+}
+
+
+HugeInt HugeInt::mod_inverse(const HugeInt &a, const HugeInt &modulus)
+{
+    if (modulus <= 0)
+        throw std::domain_error("Modulus of the modular inverse must be positive.");
+
+    HugeInt x = a % modulus;
+    if (x.is_Negative())
+        x += modulus;
+    HugeInt y = modulus;
+    ReductionMatrix m;
+    reduce_Euclid(x, y, &m);
+
+    // (a mod modulus; modulus) = M (x; y), one of x and y is the gcd and the other one 0, so the gcd is either
+    // m22 a - m12 modulus or -m21 a + m11 modulus
+    if ((x == 0 ? y : x) != 1)
+        throw std::domain_error("HugeInt has no inverse modulo a modulus it isn't coprime to.");
+    HugeInt inverse = x == 0 ? HugeInt(-m.m21) : m.m22;
+    inverse %= modulus;
+    if (inverse.is_Negative())
+        inverse += modulus;
+    return inverse;
+}
+
+
+static HugeInt power(const HugeInt &x, unsigned exponent)
+{
+    HugeInt result(1), square = x;
+    while (exponent)
+    {
+        if (exponent & 1)
+            result *= square;
+        exponent >>= 1;
+        if (exponent)
+            square = square.square();
+    }
+    return result;
+}
+
+
+/**
+ * @brief floor(x^(1/n)) of x >= 0 by Newton's iteration from above. It starts from the root of the leading half of the
+ * bits, which is correct to about half of the bits, so that a couple of iterations at full precision are enough.
+ */
+static HugeInt get_Root(const HugeInt &x, unsigned n)
+{
+    if (x == 0)
+        return x;
+
+    size_t root_bits = (x.get_BitLength() + n - 1) / n;
+    HugeInt root(0);
+    if (root_bits <= BASE_UINT_BITS)
+        root = HugeInt(1) << root_bits;
+    else
+    {
+        // x < (t + 1) 2^(n k) for t = x >> n k, so (root(t) + 1) 2^k is above the root of x
+        size_t k = root_bits / 2;
+        root = (get_Root(x >> n * k, n) + 1) << k;
+    }
+
+    // from above the root the iterations decrease until they reach it
+    HugeInt n_value = HugeInt::BaseInt(n), n_minus_one = HugeInt::BaseInt(n - 1);
+    while (true)
+    {
+        HugeInt next = (root * n_minus_one + x / power(root, n - 1)) / n_value;
+        if (next >= root)
+            return root;
+        root = std::move(next);
+    }
+}
+
+
+HugeInt HugeInt::isqrt(const HugeInt &x)
+{
+    if (x.is_Negative())
+        throw std::domain_error("Square root of a negative HugeInt.");
+    return get_Root(x, 2);
+}
+
+
+HugeInt HugeInt::iroot(const HugeInt &x, unsigned n)
+{
+    if (n == 0)
+        throw std::domain_error("0th root of a HugeInt.");
+    if (!x.is_Negative())
+        return get_Root(x, n);
+    if (n % 2 == 0)
+        throw std::domain_error("Even root of a negative HugeInt.");
+    return -get_Root(-x, n);
+}
@@ -0,0 +1,97 @@
+#include "parallel_tasks.h"
+#include <thread>
+#include <vector>
+#include <exception>
+#include <system_error>
+#include <algorithm>
+
+
+
+namespace limbs
+{
+
+
+// 0 on the threads not started by run_Tasks
+static thread_local size_t thread_budget = 0;
+
+
+size_t get_ThreadBudget()
+{
+    return thread_budget ? thread_budget : std::max<size_t>(HugeInt::multiplication_threads, 1);
+}
+
+
+void run_Tasks(const Task *tasks, size_t num_tasks)
+{
+    size_t budget = get_ThreadBudget();
+    size_t num_groups = std::min(budget, num_tasks);
+
+    // group g runs the tasks g, g + num_groups, ... with its share of the budget
+    std::vector<std::exception_ptr> errors(num_groups);
+    auto run_Group = [&](size_t g)
+    {
+        size_t previous_budget = thread_budget;
+        thread_budget = budget / num_groups + (g < budget % num_groups);
+        try
+        {
+            for (size_t i = g; i < num_tasks; i += num_groups)
+                tasks[i]();
+        }
+        catch (...)
+        {
+            errors[g] = std::current_exception();
+        }
+        thread_budget = previous_budget;
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<size_t> unstarted_groups;
+    threads.reserve(num_groups);
+    for (size_t g = 1; g < num_groups; ++g)
+    {
+        try
+        {
+            threads.emplace_back(run_Group, g);
+        }
+        catch (const std::system_error &)
+        {
+            // out of threads, the calling one will do it
+            unstarted_groups.push_back(g);
+        }
+    }
+
+    run_Group(0);
+    for (size_t g : unstarted_groups)
+        run_Group(g);
+    for (auto &thread : threads)
+        thread.join();
+
+    for (auto &error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+
+void run_ParallelFor(size_t n, const std::function<void(size_t begin, size_t end)> &body)
+{
+    size_t num_ranges = std::min(get_ThreadBudget(), n);
+    if (num_ranges <= 1)
+    {
+        body(0, n);
+        return;
+    }
+
+    std::vector<Task> tasks;
+    tasks.reserve(num_ranges);
+    for (size_t i = 0; i < num_ranges; ++i)
+    {
+        size_t begin = n * i / num_ranges, end = n * (i + 1) / num_ranges;
+        tasks.emplace_back([&body, begin, end] { body(begin, end); });
+    }
+    run_Tasks(tasks.data(), tasks.size());
+}
+
+
+}
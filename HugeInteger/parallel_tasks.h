@@ -0,0 +1,66 @@
+#ifndef __PARALLEL_TASKS__
+#define __PARALLEL_TASKS__
+
+
+#include <cstddef>
+#include <functional>
+
+#include "huge_integer.h"
+
+
+
+/**
+ * Fork-join parallelism of the limb routines. Every thread has a budget of threads its current computation may use,
+ * itself included. Threads not started from here get HugeInt::multiplication_threads. Running a group of tasks splits
+ * the budget between them, so recursive algorithms (Karatsuba, Toom-3) spread over the threads at their top levels
+ * and go sequential as soon as each part is left with a single thread.
+ * Tasks started on new threads allocate their scratch memory from the heap, not the allocator of the caller.
+ */
+namespace limbs
+{
+
+using Task = std::function<void()>;
+
+/**
+ * @brief Number of threads the computation on the calling thread may use, at least 1.
+ */
+size_t get_ThreadBudget();
+
+/**
+ * @brief Whether the parts of an operation on operands of this size (in limbs) should be computed in parallel.
+ */
+inline bool is_Parallel(size_t size)
+{
+    return size >= HugeInt::parallel_threshold && get_ThreadBudget() > 1;
+}
+
+/**
+ * @brief Run the tasks with the budget of the calling thread split between them, the calling thread takes part.
+ * If there are more tasks than threads, some run one after another. Rethrows an exception of any of the tasks.
+ */
+void run_Tasks(const Task *tasks, size_t num_tasks);
+
+/**
+ * @brief Run the functions, in parallel by run_Tasks if is_Parallel(size), one after another otherwise.
+ */
+template <typename... Functions>
+void run_Tasks(size_t size, Functions &&...functions)
+{
+    if (!is_Parallel(size))
+    {
+        (functions(), ...);
+        return;
+    }
+    const Task tasks[] = {Task(std::ref(functions))...};
+    run_Tasks(tasks, sizeof...(functions));
+}
+
+/**
+ * @brief Call body(begin, end) on consecutive ranges splitting [0, n), one range per thread of the budget.
+ */
+void run_ParallelFor(size_t n, const std::function<void(size_t begin, size_t end)> &body);
+
+}
+
+
+#endif
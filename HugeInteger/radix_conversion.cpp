@@ -0,0 +1,252 @@
+#include "limb_arithmetic.h"
+#include "limb_allocator.h"
+#include <vector>
+#include <algorithm>
+
+
+
+/**
+ * Conversion between decimal strings and limbs.
+ * Digits are processed in chunks of DECIMAL_CHUNK_DIGITS, the largest number of decimal digits that fits a single limb
+ * (9 for 32-bit limbs, 19 for 64-bit ones). Large numbers are split by the powers (10^DECIMAL_CHUNK_DIGITS)^(2^j), so
+ * that the conversion costs a few multiplications (divisions when formatting) of the sizes of the halves instead of
+ * a quadratic number of limb passes.
+ */
+namespace limbs
+{
+
+
+namespace
+{
+
+constexpr size_t get_DecimalChunkDigits()
+{
+    size_t digits = 0;
+    for (Limb x = Limb(~0); x >= 10; x /= 10)
+        ++digits;
+    return digits;
+}
+
+static constexpr size_t DECIMAL_CHUNK_DIGITS = get_DecimalChunkDigits();
+
+constexpr Limb get_DecimalChunkBase()
+{
+    Limb base = 1;
+    for (size_t i = 0; i < DECIMAL_CHUNK_DIGITS; ++i)
+        base *= 10;
+    return base;
+}
+
+static constexpr Limb DECIMAL_CHUNK_BASE = get_DecimalChunkBase();
+
+// Numbers up to this many chunks (or limbs when formatting) are converted chunk by chunk
+static constexpr size_t BASECASE_CHUNKS = 64;
+
+
+/**
+ * @brief Powers (10^DECIMAL_CHUNK_DIGITS)^(2^j), j = 0, 1, ..., as normalized limbs, computed by repeated squaring on demand.
+ */
+class PowersOfChunkBase
+{
+    std::vector<std::vector<Limb>> powers;
+
+public:
+    PowersOfChunkBase() : powers{{DECIMAL_CHUNK_BASE}} {}
+
+    const std::vector<Limb> &get(size_t j)
+    {
+        while (powers.size() <= j)
+        {
+            const auto &last = powers.back();
+            std::vector<Limb> square(2 * last.size());
+            multiply_Limbs(square.data(), last.data(), last.size(), last.data(), last.size());
+            square.resize(get_NormalizedSize(square.data(), square.size()));
+            powers.push_back(std::move(square));
+        }
+        return powers[j];
+    }
+};
+
+
+/**
+ * @brief Largest j such that 2^j chunks are less than 'num_chunks' chunks.
+ */
+size_t get_SplitLevel(size_t num_chunks)
+{
+    size_t j = 0;
+    while ((size_t(2) << j) < num_chunks)
+        ++j;
+    return j;
+}
+
+
+inline Limb read_Chunk(const char *digits, size_t num_digits)
+{
+    Limb chunk = 0;
+    for (size_t i = 0; i < num_digits; ++i)
+        chunk = chunk * 10 + Limb(digits[i] - '0');
+    return chunk;
+}
+
+
+void parse_Basecase(std::vector<Limb> &result, const char *digits, size_t num_digits)
+{
+    result.clear();
+    size_t first_chunk_digits = num_digits % DECIMAL_CHUNK_DIGITS;
+    if (first_chunk_digits == 0)
+        first_chunk_digits = DECIMAL_CHUNK_DIGITS;
+
+    Limb chunk = read_Chunk(digits, first_chunk_digits);
+    if (chunk)
+        result.push_back(chunk);
+
+    for (size_t i = first_chunk_digits; i < num_digits; i += DECIMAL_CHUNK_DIGITS)
+    {
+        chunk = read_Chunk(digits + i, DECIMAL_CHUNK_DIGITS);
+        Limb high = multiply_by_Limb(result.data(), result.data(), result.size(), DECIMAL_CHUNK_BASE);
+        if (result.empty())
+            high = chunk;
+        else
+            high += add_Into(result.data(), result.size(), &chunk, 1);
+        if (high)
+            result.push_back(high);
+    }
+}
+
+
+void parse_Recursive(std::vector<Limb> &result, const char *digits, size_t num_digits, PowersOfChunkBase &powers)
+{
+    size_t num_chunks = (num_digits + DECIMAL_CHUNK_DIGITS - 1) / DECIMAL_CHUNK_DIGITS;
+    if (num_chunks <= BASECASE_CHUNKS)
+    {
+        parse_Basecase(result, digits, num_digits);
+        return;
+    }
+
+    // result = high * (10^DECIMAL_CHUNK_DIGITS)^(2^j) + low, where low consists of the last 2^j chunks
+    size_t j = get_SplitLevel(num_chunks);
+    size_t low_digits = DECIMAL_CHUNK_DIGITS << j;
+    size_t high_digits = num_digits - low_digits;
+
+    std::vector<Limb> high, low;
+    parse_Recursive(high, digits, high_digits, powers);
+    parse_Recursive(low, digits + high_digits, low_digits, powers);
+
+    const auto &power = powers.get(j);
+    result.assign(high.size() + power.size(), 0);
+    if (!high.empty())
+    {
+        if (high.size() >= power.size())
+            multiply_Limbs(result.data(), high.data(), high.size(), power.data(), power.size());
+        else
+            multiply_Limbs(result.data(), power.data(), power.size(), high.data(), high.size());
+    }
+    if (result.size() <= low.size())
+        result.resize(low.size() + 1, 0);
+    add_Into(result.data(), result.size(), low.data(), low.size());
+    result.resize(get_NormalizedSize(result.data(), result.size()));
+}
+
+
+/**
+ * @brief Write chunk as exactly DECIMAL_CHUNK_DIGITS digits, ending right before 'end'.
+ */
+inline void write_Chunk(char *end, Limb chunk)
+{
+    for (size_t i = 0; i < DECIMAL_CHUNK_DIGITS; ++i)
+    {
+        *--end = char('0' + chunk % 10);
+        chunk /= 10;
+    }
+}
+
+
+/**
+ * @brief Write exactly 'width' decimal digits of x (zero padded), x < 10^width.
+ */
+void format_Basecase(char *out, size_t width, const Limb *x, size_t xn)
+{
+    LimbBuffer quotient(xn);
+    std::copy(x, x + xn, quotient.data());
+    size_t qn = get_NormalizedSize(quotient.data(), xn);
+
+    char *end = out + width;
+    char chunk_buffer[DECIMAL_CHUNK_DIGITS];
+    while (qn > 0 && end > out)
+    {
+        Limb chunk = divide_by_Limb(quotient.data(), quotient.data(), qn, DECIMAL_CHUNK_BASE);
+        qn = get_NormalizedSize(quotient.data(), qn);
+
+        size_t chunk_digits = std::min<size_t>(DECIMAL_CHUNK_DIGITS, end - out);
+        write_Chunk(chunk_buffer + DECIMAL_CHUNK_DIGITS, chunk);
+        end = std::copy_backward(chunk_buffer + DECIMAL_CHUNK_DIGITS - chunk_digits,
+                                 chunk_buffer + DECIMAL_CHUNK_DIGITS, end);
+    }
+    std::fill(out, end, '0');
+}
+
+
+void format_Recursive(char *out, size_t width, const Limb *x, size_t xn, PowersOfChunkBase &powers)
+{
+    xn = get_NormalizedSize(x, xn);
+    if (xn <= BASECASE_CHUNKS)
+    {
+        format_Basecase(out, width, x, xn);
+        return;
+    }
+
+    // x = high * (10^DECIMAL_CHUNK_DIGITS)^(2^j) + low with the power about half as long as x
+    size_t j = 0;
+    while (2 * powers.get(j + 1).size() <= xn)
+        ++j;
+    const auto &power = powers.get(j);
+    size_t pn = power.size();
+    size_t low_width = DECIMAL_CHUNK_DIGITS << j;
+
+    LimbBuffer buffer(xn + 1);
+    Limb *high = buffer.data();
+    Limb *low = high + xn - pn + 1;
+    divide_Limbs(high, low, x, xn, power.data(), pn);
+
+    format_Recursive(out, width - low_width, high, xn - pn + 1, powers);
+    format_Recursive(out + width - low_width, low_width, low, pn, powers);
+}
+
+}
+
+
+std::vector<Limb> parse_Decimal(const char *digits, size_t num_digits)
+{
+    std::vector<Limb> result;
+    if (num_digits > 0)
+    {
+        PowersOfChunkBase powers;
+        parse_Recursive(result, digits, num_digits, powers);
+    }
+    return result;
+}
+
+
+void format_Decimal(std::string &result, const Limb *x, size_t xn)
+{
+    xn = get_NormalizedSize(x, xn);
+    if (xn == 0)
+    {
+        result += '0';
+        return;
+    }
+
+    // log10(2) < 0.30103, so this is never less than the actual number of digits
+    size_t width = size_t(xn * LIMB_BITS * 0.30103) + 1;
+    size_t start = result.size();
+    result.resize(start + width);
+
+    PowersOfChunkBase powers;
+    format_Recursive(&result[start], width, x, xn, powers);
+
+    size_t first_digit = result.find_first_not_of('0', start);
+    result.erase(start, first_digit - start);
+}
+
+
+}
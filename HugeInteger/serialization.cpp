@@ -0,0 +1,268 @@
+#include "serialization.h"
+#include "limb_allocator.h"
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <system_error>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <limits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+
+using serialization::HEADER_SIZE;
+
+
+static bool is_LittleEndian()
+{
+    uint16_t x = 1;
+    unsigned char first_byte;
+    std::memcpy(&first_byte, &x, 1);
+    return first_byte == 1;
+}
+
+
+static void store_LittleEndian(unsigned char *bytes, uint64_t x, size_t num_bytes)
+{
+    for (size_t i = 0; i < num_bytes; ++i)
+        bytes[i] = static_cast<unsigned char>(x >> (8 * i));
+}
+
+
+static uint64_t load_LittleEndian(const unsigned char *bytes, size_t num_bytes)
+{
+    uint64_t x = 0;
+    for (size_t i = 0; i < num_bytes; ++i)
+        x |= uint64_t(bytes[i]) << (8 * i);
+    return x;
+}
+
+
+serialization::Header serialization::read_Header(const unsigned char *bytes)
+{
+    Header header;
+    header.base_uint_bytes = bytes[5];
+    header.is_negative = bytes[6];
+    header.count = load_LittleEndian(bytes + 8, 8);
+
+    if (!std::equal(MAGIC, MAGIC + 4, bytes) || bytes[4] != VERSION)
+        throw std::invalid_argument("Not a serialized HugeInt.");
+    if ((header.base_uint_bytes != 4 && header.base_uint_bytes != 8) || bytes[6] > 1 || bytes[7] != 0 || !header.count)
+        throw std::invalid_argument("Corrupted header of a serialized HugeInt.");
+    return header;
+}
+
+
+void HugeInt::serialize(std::ostream &os) const
+{
+    unsigned char header[HEADER_SIZE] = {};
+    std::copy(serialization::MAGIC, serialization::MAGIC + 4, header);
+    header[4] = serialization::VERSION;
+    header[5] = sizeof(BaseUint);
+    header[6] = is_Negative();
+    store_LittleEndian(header + 8, size, 8);
+    os.write(reinterpret_cast<const char *>(header), HEADER_SIZE);
+
+    const BaseUint *data = get_BaseUints();
+    if (is_LittleEndian())
+    {
+        os.write(reinterpret_cast<const char *>(data), std::streamsize(size * sizeof(BaseUint)));
+        return;
+    }
+
+    static constexpr size_t chunk_size = 4096 / sizeof(BaseUint);
+    unsigned char chunk[chunk_size * sizeof(BaseUint)];
+    for (size_t begin = 0; begin < size; begin += chunk_size)
+    {
+        size_t n = std::min(chunk_size, size - begin);
+        for (size_t i = 0; i < n; ++i)
+            store_LittleEndian(chunk + i * sizeof(BaseUint), data[begin + i], sizeof(BaseUint));
+        os.write(reinterpret_cast<const char *>(chunk), std::streamsize(n * sizeof(BaseUint)));
+    }
+}
+
+
+HugeInt HugeInt::deserialize(std::istream &is)
+{
+    unsigned char header_bytes[HEADER_SIZE];
+    if (!is.read(reinterpret_cast<char *>(header_bytes), HEADER_SIZE))
+        throw std::invalid_argument("Truncated serialized HugeInt.");
+    serialization::Header header = serialization::read_Header(header_bytes);
+    if (header.count > std::numeric_limits<size_t>::max() / 8)
+        throw std::invalid_argument("Serialized HugeInt is too large.");
+
+    size_t num_bytes = header.count * header.base_uint_bytes;
+    bool is_native = header.base_uint_bytes == sizeof(BaseUint) && is_LittleEndian();
+
+    // The count of the header is trusted with an allocation only as far as the stream says it has the bytes (string
+    // streams and regular files do). Past them the memory grows with the payload, every step reading at most as much
+    // as the steps before it, so a count past the end of the stream costs at most about twice the payload before it's
+    // found truncated.
+    static constexpr size_t min_step_bytes = 4096;
+    size_t available_bytes = size_t(std::max<std::streamsize>(is.rdbuf()->in_avail(), 0));
+    HugeInt result(0);
+    for (size_t begin = 0; begin < num_bytes;)
+    {
+        size_t end = begin + std::min(num_bytes - begin, std::max({min_step_bytes, begin, available_bytes}));
+        // steps end on whole base integers (min_step_bytes is a multiple of them), as the ones of the other size are
+        // put together by ORing in the bytes of a step into zeroed ones
+        if (end < num_bytes)
+            end -= end % sizeof(BaseUint);
+        size_t end_size = (end + sizeof(BaseUint) - 1) / sizeof(BaseUint);
+        result.reserve_Capacity(end_size);
+        BaseUint *data = result.get_BaseUints();
+
+        if (is_native)
+        {
+            // the representation as it is, straight into place
+            is.read(reinterpret_cast<char *>(data) + begin, std::streamsize(end - begin));
+        }
+        else
+        {
+            // base integers of the other size or the other byte order, byte by byte
+            std::fill(data + begin / sizeof(BaseUint), data + end_size, 0);
+            unsigned char chunk[min_step_bytes];
+            for (size_t chunk_begin = begin; chunk_begin < end && is; chunk_begin += sizeof(chunk))
+            {
+                size_t n = std::min(sizeof(chunk), end - chunk_begin);
+                is.read(reinterpret_cast<char *>(chunk), std::streamsize(n));
+                for (size_t i = 0; i < n; ++i)
+                {
+                    size_t k = chunk_begin + i;
+                    data[k / sizeof(BaseUint)] |= BaseUint(chunk[i]) << (8 * (k % sizeof(BaseUint)));
+                }
+            }
+            // an odd number of 4 byte integers leaves the upper half of the last one to the sign extension
+            if (end == num_bytes && num_bytes % sizeof(BaseUint) && header.is_negative)
+                data[end_size - 1] |= ~BaseUint(0) << (8 * (num_bytes % sizeof(BaseUint)));
+        }
+
+        if (!is)
+            throw std::invalid_argument("Truncated serialized HugeInt.");
+        result.size = end_size;
+        begin = end;
+    }
+
+    if (result.is_Negative() != header.is_negative)
+        throw std::invalid_argument("Sign of a serialized HugeInt doesn't match its header.");
+    // values written by the other base integer size (or by hand) may be longer than needed
+    result.normalize();
+    return result;
+}
+
+
+
+/**
+ * @brief Owner of the memory HugeIntView values borrow. Those values are constant, so it's never asked for memory,
+ * and when they're destroyed there's nothing to give back.
+ */
+class BorrowedLimbAllocator : public LimbAllocator
+{
+public:
+    BaseUint *allocate(size_t) override
+    {
+        throw std::logic_error("HugeIntView values can't be reallocated.");
+    }
+
+    void deallocate(BaseUint *, size_t) noexcept override {}
+};
+
+static BorrowedLimbAllocator borrowed_allocator;
+
+
+HugeIntView::HugeIntView(const void *data, size_t size) : value(0)
+{
+    using BaseUint = HugeInt::BaseUint;
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    if (size < HEADER_SIZE)
+        throw std::invalid_argument("Truncated serialized HugeInt.");
+    serialization::Header header = serialization::read_Header(bytes);
+
+    if (header.base_uint_bytes != sizeof(BaseUint) || !is_LittleEndian())
+        throw std::invalid_argument("HugeIntView needs base integers of the size and byte order of this build.");
+    if (header.count > (size - HEADER_SIZE) / sizeof(BaseUint))
+        throw std::invalid_argument("Truncated serialized HugeInt.");
+    if (reinterpret_cast<uintptr_t>(bytes + HEADER_SIZE) % alignof(BaseUint))
+        throw std::invalid_argument("Base integers of HugeIntView must be aligned.");
+
+    size_t count = header.count;
+    const BaseUint *base_uints = reinterpret_cast<const BaseUint *>(bytes + HEADER_SIZE);
+    serialized_size = HEADER_SIZE + count * sizeof(BaseUint);
+
+    if (count <= HugeInt::INLINE_CAPACITY)
+        std::copy(base_uints, base_uints + count, value.data.inline_vals);
+    else
+    {
+        // only constant references to the value are given out, so the memory is never written to
+        value.data.heap.ptr = const_cast<BaseUint *>(base_uints);
+        value.data.heap.allocator = &borrowed_allocator;
+        value.capacity = count;
+    }
+    value.size = count;
+
+    if (value.is_Negative() != header.is_negative)
+        throw std::invalid_argument("Sign of a serialized HugeInt doesn't match its header.");
+    value.normalize();
+}
+
+
+
+#if defined(__unix__) || defined(__APPLE__)
+
+MappedFile::MappedFile(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "Can't open " + path);
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0)
+    {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "Can't stat " + path);
+    }
+
+    // an empty file can't be mapped, but there's nothing to map either
+    size = size_t(file_stat.st_size);
+    if (size)
+    {
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Can't map " + path);
+        }
+        ptr = mapping;
+    }
+    // the mapping stays valid without the descriptor
+    close(fd);
+}
+
+
+MappedFile::~MappedFile()
+{
+    if (ptr)
+        munmap(ptr, size);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path)
+{
+    throw std::system_error(std::make_error_code(std::errc::function_not_supported), "Can't map " + path);
+}
+
+
+MappedFile::~MappedFile() {}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef __SERIALIZATION__
+#define __SERIALIZATION__
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "huge_integer.h"
+
+
+
+/**
+ * Binary format of HugeInt (HugeInt::serialize, HugeInt::deserialize), all numbers little-endian:
+ *
+ *   offset 0   4 bytes   magic "HUGE"
+ *   offset 4   1 byte    version, 1
+ *   offset 5   1 byte    bytes per base integer, 4 or 8
+ *   offset 6   1 byte    1 if the value is negative, 0 otherwise
+ *   offset 7   1 byte    0
+ *   offset 8   8 bytes   number of base integers, at least 1
+ *   offset 16            the base integers in two's complement, the last bit of the last one is the sign bit
+ *
+ * The base integers are stored exactly as HugeInt keeps them in memory, so a serialized value written by a build with
+ * the same base integer size can be used in place by HugeIntView. Values of the other size are converted on reading.
+ */
+namespace serialization
+{
+
+static constexpr char MAGIC[4] = {'H', 'U', 'G', 'E'};
+static constexpr uint8_t VERSION = 1;
+static constexpr size_t HEADER_SIZE = 16;
+
+struct Header
+{
+    unsigned base_uint_bytes;
+    bool is_negative;
+    uint64_t count;
+};
+
+/**
+ * @brief Parse and validate a header of HEADER_SIZE bytes. Throws std::invalid_argument if it's not a header of
+ * a serialized HugeInt.
+ */
+Header read_Header(const unsigned char *bytes);
+
+}
+
+
+/**
+ * @brief Read-only HugeInt living in memory it doesn't own: a serialized value in a buffer or, without any copying,
+ * in a memory mapped file (see MappedFile). The memory must outlive the view and stay unchanged.
+ */
+class HugeIntView
+{
+    HugeInt value;
+    size_t serialized_size;
+
+public:
+    /**
+     * @brief View of the serialized value in the beginning of the 'size' bytes at 'data'. The base integers must be of
+     * the size of HugeInt::BaseUint and aligned for it (which they are at the beginning of a mapped file), the host
+     * little-endian. Throws std::invalid_argument otherwise or if the data is not a serialized HugeInt.
+     */
+    HugeIntView(const void *data, size_t size);
+    HugeIntView(const HugeIntView &) = delete;
+    HugeIntView& operator=(const HugeIntView &) = delete;
+
+    const HugeInt &get() const
+    {
+        return value;
+    }
+
+    operator const HugeInt &() const
+    {
+        return value;
+    }
+
+    // Number of bytes the value takes, the next one (if any) starts right after it.
+    size_t get_SerializedSize() const
+    {
+        return serialized_size;
+    }
+};
+
+
+/**
+ * @brief Whole file mapped into memory read-only, for HugeIntView to use checkpoints without reading them.
+ * Throws std::system_error if the file can't be opened or mapped.
+ */
+class MappedFile
+{
+    void *ptr = nullptr;
+    size_t size = 0;
+
+public:
+    explicit MappedFile(const std::string &path);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile& operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    const void *data() const
+    {
+        return ptr;
+    }
+
+    size_t get_Size() const
+    {
+        return size;
+    }
+};
+
+
+#endif
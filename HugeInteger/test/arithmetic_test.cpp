@@ -0,0 +1,512 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <limits>
+#include <stdexcept>
+
+
+#include "huge_integer.h"
+#include "fixed_huge_integer.h"
+#include "limb_arithmetic.h"
+#include "limb_kernels_x86_64.h"
+
+
+/*
+ * Correctness checks of every algorithm against the simplest one. The thresholds are lowered, so that the algorithms
+ * for large operands run on operands small enough for schoolbook multiplication and division to check them, and
+ * the results of the number theoretic functions are checked by their definitions.
+ */
+
+using BaseUint = HugeInt::BaseUint;
+
+static constexpr size_t never = std::numeric_limits<size_t>::max();
+
+static int num_failed = 0;
+static int num_checks = 0;
+
+
+static void check(bool condition, const std::string &what)
+{
+    ++num_checks;
+    if (!condition)
+    {
+        std::cout << "FAILED " << what << '\n';
+        ++num_failed;
+    }
+}
+
+
+struct Thresholds
+{
+    const char *name;
+    size_t karatsuba_threshold;
+    size_t karatsuba_square_threshold;
+    size_t toom3_threshold;
+    size_t ntt_threshold;
+    size_t burnikel_ziegler_threshold;
+    size_t multiplication_threads;
+    size_t parallel_threshold;
+
+    void apply() const
+    {
+        HugeInt::karatsuba_threshold = karatsuba_threshold;
+        HugeInt::karatsuba_square_threshold = karatsuba_square_threshold;
+        HugeInt::toom3_threshold = toom3_threshold;
+        HugeInt::ntt_threshold = ntt_threshold;
+        HugeInt::burnikel_ziegler_threshold = burnikel_ziegler_threshold;
+        HugeInt::multiplication_threads = multiplication_threads;
+        HugeInt::parallel_threshold = parallel_threshold;
+    }
+};
+
+static const Thresholds defaults = {"default", HugeInt::karatsuba_threshold, HugeInt::karatsuba_square_threshold,
+                                    HugeInt::toom3_threshold, HugeInt::ntt_threshold,
+                                    HugeInt::burnikel_ziegler_threshold, HugeInt::multiplication_threads,
+                                    HugeInt::parallel_threshold};
+
+static const Thresholds schoolbook = {"schoolbook", never, never, never, never, never, 1, never};
+
+// every algorithm as early as it may run
+static const Thresholds algorithms[] = {
+    {"karatsuba", 4, 4, never, never, never, 1, never},
+    {"toom3", 4, 4, 5, never, never, 1, never},
+    {"ntt", 4, 4, 5, 8, never, 1, never},
+    {"burnikel-ziegler", 4, 4, 5, 64, 2, 1, never},
+    {"parallel", 4, 4, 16, 256, 2, 4, 8},
+};
+
+
+// random value of 'size' base integers, with runs of zeros and ones in them for the carries to go far
+static HugeInt make_Random(std::mt19937_64 &rng, size_t size)
+{
+    std::vector<BaseUint> base_uints(size);
+    for (BaseUint &x : base_uints)
+    {
+        switch (rng() % 4)
+        {
+        case 0:
+            x = 0;
+            break;
+        case 1:
+            x = ~BaseUint(0);
+            break;
+        default:
+            x = BaseUint(rng());
+        }
+    }
+    return HugeInt(base_uints.data(), size);
+}
+
+
+static HugeInt make_NonZero(std::mt19937_64 &rng, size_t size)
+{
+    HugeInt x = make_Random(rng, size);
+    return x == 0 ? HugeInt(1) : x;
+}
+
+
+static HugeInt get_Abs(const HugeInt &x)
+{
+    return x < 0 ? HugeInt(0) - x : x;
+}
+
+
+static HugeInt power(const HugeInt &x, unsigned n)
+{
+    HugeInt result(1);
+    for (unsigned i = 0; i < n; ++i)
+        result *= x;
+    return result;
+}
+
+
+static void check_Multiplication(std::mt19937_64 &rng)
+{
+    for (int i = 0; i < 60; ++i)
+    {
+        size_t an = 1 + rng() % 700;
+        size_t bn = i % 3 == 0 ? an : 1 + rng() % an;
+        HugeInt a = make_Random(rng, an), b = make_Random(rng, bn);
+        HugeInt b_copy = a;
+
+        schoolbook.apply();
+        HugeInt product = a, square = a, same = a;
+        product *= b;
+        square = a.square();
+        same *= b_copy;
+
+        for (const Thresholds &thresholds : algorithms)
+        {
+            thresholds.apply();
+            std::string what = std::string(thresholds.name) + " multiplication of " + std::to_string(an) + " by "
+                               + std::to_string(bn) + " base integers";
+            HugeInt x = a;
+            x *= b;
+            check(x == product, what);
+            check(a.square() == square, std::string(thresholds.name) + " squaring of " + std::to_string(an));
+            // equal values in different objects aren't squared
+            x = a;
+            x *= b_copy;
+            check(x == same, what + " (equal operands)");
+        }
+    }
+    defaults.apply();
+}
+
+
+static void check_Division(std::mt19937_64 &rng)
+{
+    for (int i = 0; i < 60; ++i)
+    {
+        size_t bn = 1 + rng() % 500;
+        size_t an = bn + rng() % 1000;
+        HugeInt a = make_Random(rng, an), b = make_NonZero(rng, bn);
+
+        schoolbook.apply();
+        HugeInt quotient(0), remainder(0);
+        HugeInt::divmod(a, b, quotient, remainder);
+
+        std::string what = " division of " + std::to_string(an) + " by " + std::to_string(bn) + " base integers";
+        check(quotient * b + remainder == a, "schoolbook" + what + ": a != q * b + r");
+        check(get_Abs(remainder) < get_Abs(b), "schoolbook" + what + ": |r| >= |b|");
+        check(remainder == 0 || (remainder < 0) == (a < 0), "schoolbook" + what + ": r of the wrong sign");
+
+        for (const Thresholds &thresholds : algorithms)
+        {
+            thresholds.apply();
+            HugeInt q(0), r(0);
+            HugeInt::divmod(a, b, q, r);
+            check(q == quotient && r == remainder, thresholds.name + what);
+            check(a / b == quotient && a % b == remainder, thresholds.name + what + " (/ and %)");
+        }
+    }
+    defaults.apply();
+
+    bool is_thrown = false;
+    try
+    {
+        HugeInt(1) / HugeInt(0);
+    }
+    catch (const std::domain_error &)
+    {
+        is_thrown = true;
+    }
+    check(is_thrown, "division by zero");
+}
+
+
+#ifdef HUGE_INT_X86_64_KERNELS
+static void check_Kernels(std::mt19937_64 &rng)
+{
+    using limbs::Limb;
+    using limbs::DoubleLimb;
+    if (!limbs::x86_64::has_MulxAdx())
+    {
+        std::cout << "no ADX on this CPU, its kernels are not checked\n";
+        return;
+    }
+
+    // all the lengths around the unrolling by 4
+    for (size_t n = 0; n <= 40; ++n)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            std::vector<Limb> a(n), r(n), expected(n);
+            for (Limb &x : a)
+                x = i % 2 ? ~Limb(0) : Limb(rng());
+            for (Limb &x : r)
+                x = i % 4 == 1 ? ~Limb(0) : Limb(rng());
+            Limb b = i % 2 ? ~Limb(0) : Limb(rng());
+
+            Limb carry = 0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                DoubleLimb p = DoubleLimb(a[j]) * b + carry;
+                expected[j] = Limb(p);
+                carry = Limb(p >> limbs::LIMB_BITS);
+            }
+            std::vector<Limb> product(n);
+            Limb result_carry = limbs::x86_64::multiply_by_Limb(product.data(), a.data(), n, b);
+            check(product == expected && result_carry == carry, "ADX multiply_by_Limb of " + std::to_string(n));
+
+            carry = 0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                DoubleLimb p = DoubleLimb(a[j]) * b + r[j] + carry;
+                expected[j] = Limb(p);
+                carry = Limb(p >> limbs::LIMB_BITS);
+            }
+            result_carry = limbs::x86_64::add_multiplied_by_Limb(r.data(), a.data(), n, b);
+            check(r == expected && result_carry == carry, "ADX add_multiplied_by_Limb of " + std::to_string(n));
+        }
+    }
+}
+#endif
+
+
+static void check_Expressions(std::mt19937_64 &rng)
+{
+    for (int i = 0; i < 40; ++i)
+    {
+        HugeInt a = make_Random(rng, 1 + rng() % 80), b = make_Random(rng, 1 + rng() % 80);
+        HugeInt c = make_Random(rng, 1 + rng() % 80), d = make_Random(rng, 1 + rng() % 80);
+        HugeInt e = make_Random(rng, 1 + rng() % 160);
+
+        HugeInt ab = a, cd = c, aa = a;
+        ab *= b;
+        cd *= d;
+        aa *= HugeInt(a);
+        HugeInt expected = ab;
+        expected += e;
+        expected -= cd;
+
+        HugeInt x = a * b + e - c * d;
+        check(x == expected, "expression a * b + e - c * d");
+        x = a * a + e;
+        check(x == aa + HugeInt(e), "expression a * a + e");
+        x = e;
+        x += a * b;
+        check(x == ab + HugeInt(e), "expression += a * b");
+        x = e;
+        x -= c * d;
+        check(x == e - HugeInt(cd), "expression -= c * d");
+        // the result is one of the terms
+        x = a;
+        x = x * b + e;
+        check(x == ab + HugeInt(e), "expression x = x * b + e");
+    }
+}
+
+
+template <size_t bits>
+static void check_FixedWidth(std::mt19937_64 &rng)
+{
+    using Fixed = FixedHugeInt<bits>;
+    const HugeInt modulus = HugeInt(1) << bits;
+    // the value of the fixed width integer wrapping around as it does
+    auto wrap = [&modulus](const HugeInt &x)
+    {
+        HugeInt y = x % modulus;
+        if (y < 0)
+            y += modulus;
+        if (y >= modulus >> 1)
+            y -= modulus;
+        return y;
+    };
+
+    for (int i = 0; i < 200; ++i)
+    {
+        HugeInt a = wrap(make_Random(rng, 1 + rng() % Fixed::SIZE));
+        HugeInt b = wrap(make_NonZero(rng, 1 + rng() % Fixed::SIZE));
+        Fixed x(a), y(b);
+        size_t shift = rng() % bits;
+        std::string what = "FixedHugeInt<" + std::to_string(bits) + "> ";
+
+        check(x.to_HugeInt() == a, what + "conversion");
+        check((x + y).to_HugeInt() == wrap(a + b), what + "+");
+        check((x - y).to_HugeInt() == wrap(a - b), what + "-");
+        check((x * y).to_HugeInt() == wrap(a * b), what + "*");
+        check((x / y).to_HugeInt() == wrap(a / b), what + "/");
+        check((x % y).to_HugeInt() == wrap(a % b), what + "%");
+        check((x << shift).to_HugeInt() == wrap(a << shift), what + "<<");
+        check((x >> shift).to_HugeInt() == (a >> shift), what + ">>");
+        check(x.to_String(10) == a.to_String(10), what + "to_String");
+        check((x < y) == (a < b) && (x == y) == (a == b), what + "comparison");
+    }
+}
+
+
+static void check_NumberTheory(std::mt19937_64 &rng)
+{
+    for (int i = 0; i < 60; ++i)
+    {
+        // square-and-multiply by the operators
+        HugeInt modulus = get_Abs(make_NonZero(rng, 1 + rng() % 12));
+        HugeInt base = make_Random(rng, 1 + rng() % 16), exponent = get_Abs(make_Random(rng, 1 + rng() % 3));
+        HugeInt expected(1), square = base % modulus;
+        for (size_t bit = 0; bit < exponent.get_BitLength(); ++bit)
+        {
+            if (((exponent >> bit) & HugeInt(1)) == 1)
+                expected = expected * square % modulus;
+            square = square * square % modulus;
+        }
+        expected %= modulus;
+        if (expected < 0)
+            expected += modulus;
+        check(HugeInt::pow_mod(base, exponent, modulus) == expected,
+              std::string("pow_mod by an ") + (((modulus & HugeInt(1)) == 1) ? "odd" : "even") + " modulus");
+    }
+
+    for (size_t threshold : {size_t(48), size_t(2)})
+    {
+        HugeInt::half_gcd_threshold = threshold;
+        for (int i = 0; i < 30; ++i)
+        {
+            HugeInt g = make_NonZero(rng, 1 + rng() % 40);
+            HugeInt a = g * make_Random(rng, 1 + rng() % 300), b = g * make_Random(rng, 1 + rng() % 300);
+
+            // Euclid by the remainders
+            HugeInt x = get_Abs(a), y = get_Abs(b);
+            while (y != 0)
+            {
+                HugeInt r = x % y;
+                x = std::move(y);
+                y = std::move(r);
+            }
+            std::string what = " with half_gcd_threshold = " + std::to_string(threshold);
+            check(HugeInt::gcd(a, b) == x, "gcd" + what);
+
+            HugeInt modulus = get_Abs(b / x);
+            HugeInt c = a / x;
+            if (modulus > 1)
+            {
+                HugeInt inverse = HugeInt::mod_inverse(c, modulus);
+                check(inverse >= 0 && inverse < modulus && (c * inverse - HugeInt(1)) % modulus == 0,
+                      "mod_inverse" + what);
+            }
+            if (x > 1 && get_Abs(b) > 1)
+            {
+                bool is_thrown = false;
+                try
+                {
+                    HugeInt::mod_inverse(a, get_Abs(b));
+                }
+                catch (const std::domain_error &)
+                {
+                    is_thrown = true;
+                }
+                check(is_thrown, "mod_inverse of a number not coprime to the modulus" + what);
+            }
+        }
+    }
+    HugeInt::half_gcd_threshold = 48;
+
+    for (int i = 0; i < 60; ++i)
+    {
+        HugeInt x = get_Abs(make_Random(rng, 1 + rng() % 100));
+        HugeInt root = HugeInt::isqrt(x);
+        check(root * root <= x && (root + HugeInt(1)) * (root + HugeInt(1)) > x, "isqrt bounds");
+
+        unsigned n = 1 + rng() % 9;
+        HugeInt y = i % 2 && n % 2 ? HugeInt(0) - x : x;
+        HugeInt r = HugeInt::iroot(y, n);
+        HugeInt abs_r = get_Abs(r);
+        check(power(abs_r, n) <= x && power(abs_r + HugeInt(1), n) > x && (r == 0 || (r < 0) == (y < 0)),
+              "iroot bounds of degree " + std::to_string(n));
+    }
+}
+
+
+static void check_Strings(std::mt19937_64 &rng)
+{
+    check(HugeInt("-123456789012345678901234567890").to_String(10) == "-123456789012345678901234567890",
+          "decimal string of a known value");
+    for (int i = 0; i < 40; ++i)
+    {
+        // past the chunk by chunk conversion of small numbers
+        HugeInt x = make_Random(rng, 1 + rng() % 2000);
+        check(HugeInt(x.to_String(10)) == x, "parse(to_String(x)) of " + std::to_string(x.get_BitLength()) + " bits");
+    }
+}
+
+
+// serialized value as a build with the other base integer size would write it
+static std::string convert_Serialized(const std::string &serialized)
+{
+    std::string result = serialized.substr(0, 16);
+    std::string payload = serialized.substr(16);
+    unsigned other_bytes = sizeof(BaseUint) == 8 ? 4 : 8;
+    bool is_negative = serialized[6];
+    while (payload.size() % other_bytes)
+        payload.push_back(is_negative ? '\xff' : '\0');
+    result[5] = char(other_bytes);
+    uint64_t count = payload.size() / other_bytes;
+    for (size_t i = 0; i < 8; ++i)
+        result[8 + i] = char(count >> (8 * i));
+    return result + payload;
+}
+
+
+// stream of a string handing out 'chunk_size' bytes at a time, as a pipe or a socket does
+class ChunkedBuffer : public std::streambuf
+{
+    std::string data;
+    size_t chunk_size;
+    size_t position = 0;
+
+public:
+    ChunkedBuffer(std::string data, size_t chunk_size) : data(std::move(data)), chunk_size(chunk_size) {}
+
+protected:
+    int_type underflow() override
+    {
+        if (position == data.size())
+            return traits_type::eof();
+        size_t n = std::min(chunk_size, data.size() - position);
+        char *begin = &data[position];
+        setg(begin, begin, begin + n);
+        position += n;
+        return traits_type::to_int_type(*begin);
+    }
+};
+
+
+static void check_Serialization(std::mt19937_64 &rng)
+{
+    for (int i = 0; i < 60; ++i)
+    {
+        HugeInt x = make_Random(rng, 1 + rng() % 3000);
+        if ((x < 0) != (i % 2 == 1))
+            x = ~x;
+        std::string sign = x < 0 ? " of a negative value" : " of a non-negative value";
+
+        std::stringstream stream;
+        x.serialize(stream);
+        check(HugeInt::deserialize(stream) == x, "serialize/deserialize" + sign);
+
+        std::string other = convert_Serialized(stream.str());
+        std::istringstream other_stream(other);
+        check(HugeInt::deserialize(other_stream) == x, "deserialize of base integers of the other size" + sign);
+
+        // steps of deserialize sized by what's buffered end in the middle of base integers
+        for (size_t chunk_size : {size_t(16 + 5001), size_t(4099)})
+        {
+            ChunkedBuffer native_buffer(stream.str(), chunk_size), other_buffer(other, chunk_size);
+            std::istream native_chunks(&native_buffer), other_chunks(&other_buffer);
+            check(HugeInt::deserialize(native_chunks) == x,
+                  "deserialize in chunks of " + std::to_string(chunk_size) + " bytes" + sign);
+            check(HugeInt::deserialize(other_chunks) == x, "deserialize of base integers of the other size in "
+                                                           "chunks of " + std::to_string(chunk_size) + " bytes" + sign);
+        }
+    }
+}
+
+
+int main()
+{
+    std::mt19937_64 rng(42);
+    std::cout << sizeof(BaseUint) * 8 << "-bit base integers\n";
+
+    check_Multiplication(rng);
+    check_Division(rng);
+#ifdef HUGE_INT_X86_64_KERNELS
+    check_Kernels(rng);
+#endif
+    check_Expressions(rng);
+    check_FixedWidth<128>(rng);
+    check_FixedWidth<256>(rng);
+    check_FixedWidth<1024>(rng);
+    check_NumberTheory(rng);
+    check_Strings(rng);
+    check_Serialization(rng);
+
+    if (num_failed)
+    {
+        std::cout << num_failed << " of " << num_checks << " checks failed\n";
+        return 1;
+    }
+    std::cout << "all " << num_checks << " checks passed\n";
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include "io_device.h"
+
+#include <algorithm>
+#include <limits>
+
+
+// longest value written as text: 10 digits and the newline
+static constexpr size_t MAX_TEXT_SIZE = 11;
+
+
+uint32_t StreamDevice::read()
+{
+    // 0 without input, or when there's nothing more to read
+    uint32_t value = 0;
+    if (input)
+    {
+        *input >> value;
+    }
+    return value;
+}
+
+
+void StreamDevice::write(uint32_t value)
+{
+    if (output)
+    {
+        *output << value << '\n';
+    }
+}
+
+
+void StreamDevice::flush()
+{
+    if (output)
+    {
+        output->flush();
+    }
+}
+
+
+
+BufferedDevice::BufferedDevice(std::istream *input, std::ostream *output, size_t buffer_size)
+: input(input ? input->rdbuf() : nullptr), output(output ? output->rdbuf() : nullptr),
+  input_buffer(std::max(buffer_size, size_t(1))), output_buffer(std::max(buffer_size, MAX_TEXT_SIZE)) {}
+
+
+BufferedDevice::~BufferedDevice()
+{
+    flush();
+}
+
+
+void BufferedDevice::flush()
+{
+    flush_Output();
+    if (output)
+    {
+        output->pubsync();
+    }
+}
+
+
+bool BufferedDevice::fill_Input()
+{
+    if (!input)
+    {
+        return false;
+    }
+    flush_Output();
+
+    // what the stream has at hand, waiting for some when it has nothing
+    std::streamsize available = input->in_avail();
+    if (available <= 0 && input->sgetc() != std::char_traits<char>::eof())
+    {
+        available = input->in_avail();
+    }
+    std::streamsize size = std::clamp<std::streamsize>(available, 1, input_buffer.size());
+    input_begin = 0;
+    input_end = std::max<std::streamsize>(input->sgetn(input_buffer.data(), size), 0);
+    return input_end != 0;
+}
+
+
+void BufferedDevice::flush_Output()
+{
+    if (output && output_size)
+    {
+        output->sputn(output_buffer.data(), output_size);
+    }
+    output_size = 0;
+}
+
+
+
+uint32_t TextDevice::read()
+{
+    if (is_failed)
+    {
+        return 0;
+    }
+
+    // whitespace of the C locale
+    int c = peek();
+    while (c == ' ' || (c >= '\t' && c <= '\r'))
+    {
+        skip();
+        c = peek();
+    }
+
+    bool is_negative = c == '-';
+    if (c == '+' || c == '-')
+    {
+        skip();
+        c = peek();
+    }
+    if (c < '0' || c > '9')
+    {
+        is_failed = true;
+        return 0;
+    }
+
+    // all the digits are read even past the largest value, which it then is
+    uint64_t value = 0;
+    constexpr uint64_t max_value = std::numeric_limits<uint32_t>::max();
+    for (; c >= '0' && c <= '9'; c = peek())
+    {
+        value = std::min(value * 10 + (c - '0'), max_value + 1);
+        skip();
+    }
+    if (value > max_value)
+    {
+        is_failed = true;
+        return max_value;
+    }
+    return is_negative ? uint32_t(-value) : uint32_t(value);
+}
+
+
+void TextDevice::write(uint32_t value)
+{
+    char digits[MAX_TEXT_SIZE];
+    size_t size = 0;
+    do
+    {
+        digits[size++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    char *text = reserve_Output(size + 1);
+    std::reverse_copy(digits, digits + size, text);
+    text[size] = '\n';
+    commit_Output(size + 1);
+}
+
+
+
+uint32_t BinaryDevice::read()
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        int c = peek();
+        if (c == EOF)
+        {
+            return 0;
+        }
+        value = value << 8 | uint32_t(c);
+        skip();
+    }
+    return value;
+}
+
+
+void BinaryDevice::write(uint32_t value)
+{
+    char *bytes = reserve_Output(4);
+    bytes[0] = value >> 24;
+    bytes[1] = value >> 16;
+    bytes[2] = value >> 8;
+    bytes[3] = value;
+    commit_Output(4);
+}
+
+
+
+RingBufferDevice::Span RingBufferDevice::Ring::get_Readable()
+{
+    size_t begin = num_read & (values.size() - 1);
+    return {values.data() + begin, std::min(get_Size(), values.size() - begin)};
+}
+
+
+RingBufferDevice::Span RingBufferDevice::Ring::get_Writable()
+{
+    size_t begin = num_written & (values.size() - 1);
+    return {values.data() + begin, std::min(values.size() - get_Size(), values.size() - begin)};
+}
+
+
+static size_t get_RingCapacity(size_t capacity)
+{
+    size_t power = 1;
+    while (power < capacity)
+    {
+        power *= 2;
+    }
+    return power;
+}
+
+
+RingBufferDevice::RingBufferDevice(size_t capacity)
+: input(get_RingCapacity(capacity)), output(get_RingCapacity(capacity)) {}
+
+
+RingBufferDevice::Span RingBufferDevice::get_InputSpace()
+{
+    return input.get_Writable();
+}
+
+
+void RingBufferDevice::commit_Input(size_t num_values)
+{
+    input.num_written += std::min(num_values, input.get_Writable().size);
+}
+
+
+bool RingBufferDevice::push_Input(uint32_t value)
+{
+    Span space = input.get_Writable();
+    if (space.size == 0)
+    {
+        return false;
+    }
+    space.values[0] = value;
+    ++input.num_written;
+    return true;
+}
+
+
+RingBufferDevice::Span RingBufferDevice::get_Output()
+{
+    return output.get_Readable();
+}
+
+
+void RingBufferDevice::consume_Output(size_t num_values)
+{
+    output.num_read += std::min(num_values, output.get_Readable().size);
+}
+
+
+bool RingBufferDevice::pop_Output(uint32_t &value)
+{
+    Span values = output.get_Readable();
+    if (values.size == 0)
+    {
+        return false;
+    }
+    value = values.values[0];
+    ++output.num_read;
+    return true;
+}
+
+
+uint32_t RingBufferDevice::read()
+{
+    if (input.get_Size() == 0)
+    {
+        return 0;
+    }
+    return input.values[input.num_read++ & (input.values.size() - 1)];
+}
+
+
+void RingBufferDevice::write(uint32_t value)
+{
+    if (output.get_Size() == output.values.size())
+    {
+        ++num_dropped;
+        return;
+    }
+    output.values[output.num_written++ & (output.values.size() - 1)] = value;
+}
@@ -0,0 +1,206 @@
+#ifndef __IO_DEVICE_H__
+#define __IO_DEVICE_H__
+
+
+#include <istream>
+#include <ostream>
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+
+
+/*
+ * What the IO register of VirtualMachine is connected to: reading the register reads the next value of the device,
+ * writing it writes a value to the device. An exception of a device leaves run() as one of exec() does, on every engine.
+ */
+class IODevice
+{
+public:
+    virtual ~IODevice() = default;
+
+    // next value, 0 when there's none
+    virtual uint32_t read() = 0;
+    virtual void write(uint32_t value) = 0;
+    // pass the values written so far on
+    virtual void flush() {}
+};
+
+
+// values as decimal text through the stream operators, one per line written, without any buffering of its own
+class StreamDevice : public IODevice
+{
+    std::istream *input;
+    std::ostream *output;
+
+public:
+    explicit StreamDevice(std::istream *input = nullptr, std::ostream *output = nullptr)
+    : input(input), output(output) {}
+
+    inline void connect_Input(std::istream *input)
+    {
+        this->input = input;
+    }
+
+    inline void connect_Output(std::ostream *output)
+    {
+        this->output = output;
+    }
+
+    uint32_t read() override;
+    void write(uint32_t value) override;
+    void flush() override;
+};
+
+
+/*
+ * Device reading and writing the stream buffers of streams in large blocks. Input is read as far as it's available,
+ * so an interactive program gets its values as soon as they're typed. Output is written when the buffer is full, on
+ * flush(), before more input is read (so prompts show up before the program waits for an answer) and when the device
+ * is destroyed.
+ */
+class BufferedDevice : public IODevice
+{
+    std::streambuf *input;
+    std::streambuf *output;
+
+    std::vector<char> input_buffer;
+    size_t input_begin = 0;
+    size_t input_end = 0;
+
+    std::vector<char> output_buffer;
+    size_t output_size = 0;
+
+public:
+    // default size of each of the buffers
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    BufferedDevice(std::istream *input, std::ostream *output, size_t buffer_size = BUFFER_SIZE);
+    BufferedDevice(const BufferedDevice &) = delete;
+    BufferedDevice& operator=(const BufferedDevice &) = delete;
+    ~BufferedDevice() override;
+
+    void flush() override;
+
+protected:
+    // next byte of input, or EOF at its end
+    inline int peek()
+    {
+        if (input_begin == input_end && !fill_Input())
+        {
+            return EOF;
+        }
+        return uint8_t(input_buffer[input_begin]);
+    }
+
+    inline void skip()
+    {
+        ++input_begin;
+    }
+
+    // room for size bytes of output, they're written by commit_Output
+    inline char *reserve_Output(size_t size)
+    {
+        if (output_size + size > output_buffer.size())
+        {
+            flush_Output();
+        }
+        return output_buffer.data() + output_size;
+    }
+
+    inline void commit_Output(size_t size)
+    {
+        output_size += size;
+    }
+
+private:
+    bool fill_Input();
+    void flush_Output();
+};
+
+
+// values as decimal text, parsed as the stream operators parse them into uint32_t, one per line written
+class TextDevice : public BufferedDevice
+{
+    // set by invalid input, as the fail bit of a stream, after which there are only 0s
+    bool is_failed = false;
+
+public:
+    using BufferedDevice::BufferedDevice;
+
+    uint32_t read() override;
+    void write(uint32_t value) override;
+};
+
+
+// values as 4 big-endian bytes each, as the VM stores them in memory, 0 for an incomplete one at the end of input
+class BinaryDevice : public BufferedDevice
+{
+public:
+    using BufferedDevice::BufferedDevice;
+
+    uint32_t read() override;
+    void write(uint32_t value) override;
+};
+
+
+/*
+ * Device for programs embedding the VM: values pass through two rings in memory, input filled and output drained by
+ * the host between runs, in place. Reading an empty input ring gives 0, values written to a full output ring are
+ * dropped, so the output ring should hold at least as many values as a run may write. Not thread-safe, the host and
+ * the VM take turns.
+ */
+class RingBufferDevice : public IODevice
+{
+public:
+    // values next to each other in a ring
+    struct Span
+    {
+        uint32_t *values;
+        size_t size;
+    };
+
+private:
+    struct Ring
+    {
+        std::vector<uint32_t> values;
+        // numbers of values read from and written to the ring so far, the next ones are at them modulo the size
+        size_t num_read = 0;
+        size_t num_written = 0;
+
+        explicit Ring(size_t capacity) : values(capacity) {}
+
+        size_t get_Size() const { return num_written - num_read; }
+        Span get_Readable();
+        Span get_Writable();
+    };
+
+    Ring input;
+    Ring output;
+    uint64_t num_dropped = 0;
+
+public:
+    // capacity of each of the rings, rounded up to a power of 2
+    explicit RingBufferDevice(size_t capacity);
+
+    // free space of the input ring up to its end, the values written to it are passed to the VM by commit_Input
+    Span get_InputSpace();
+    void commit_Input(size_t num_values);
+    bool push_Input(uint32_t value);
+
+    // values the VM wrote up to the end of the output ring, they're taken out of it by consume_Output
+    Span get_Output();
+    void consume_Output(size_t num_values);
+    bool pop_Output(uint32_t &value);
+
+    // values written to the full output ring
+    uint64_t get_NumDropped() const { return num_dropped; }
+
+    uint32_t read() override;
+    void write(uint32_t value) override;
+};
+
+
+#endif
@@ -0,0 +1,502 @@
+#include "jit_x86_64.h"
+
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define VM_JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+
+// size of the executable memory, all the blocks are dropped when it's full
+static constexpr size_t CODE_CAPACITY = 1 << 20;
+// longest block, in instructions
+static constexpr size_t MAX_BLOCK_INSTRUCTIONS = 64;
+
+
+/**
+ * @brief Machine code of a block. Registers of compiled code:
+ *   rbx - VM registers, r12 - VM memory, r13 - the VM, r14 - the instruction budget, r15 - its value,
+ *   eax - first source and the result, ecx - second source, [rsp] - first source while reading the second one.
+ */
+class Emitter
+{
+    std::vector<unsigned char> bytes;
+
+public:
+    const std::vector<unsigned char> &get_Bytes() const { return bytes; }
+    size_t get_Size() const { return bytes.size(); }
+
+    void emit(std::initializer_list<unsigned char> code)
+    {
+        bytes.insert(bytes.end(), code);
+    }
+
+    void emit32(uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            bytes.push_back(uint8_t(value >> (8 * i)));
+        }
+    }
+
+    void emit64(uint64_t value)
+    {
+        emit32(uint32_t(value));
+        emit32(uint32_t(value >> 32));
+    }
+
+    // registers: 0 - eax, 1 - ecx, 2 - edx
+
+    void mov_Immediate(int reg, uint32_t value)
+    {
+        emit({uint8_t(0xB8 + reg)});
+        emit32(value);
+    }
+
+    // mov reg, [rbx + 4 * index]
+    void load_Register(int reg, uint8_t index)
+    {
+        emit({0x8B, uint8_t(0x43 | reg << 3), uint8_t(4 * index)});
+    }
+
+    // mov [rbx + 4 * index], eax
+    void store_Register(uint8_t index)
+    {
+        emit({0x89, 0x43, uint8_t(4 * index)});
+    }
+
+    // VM memory is big-endian: mov reg, [r12 + address]; bswap reg
+    void load_Memory(int reg, uint32_t address)
+    {
+        emit({0x41, 0x8B, uint8_t(0x84 | reg << 3), 0x24});
+        emit32(address);
+        emit({0x0F, uint8_t(0xC8 + reg)});
+    }
+
+    // eax = function(vm, eax)
+    void call(const void *function)
+    {
+        emit({0x89, 0xC6});                                // mov esi, eax
+        emit({0x4C, 0x89, 0xEF});                          // mov rdi, r13
+        emit({0x48, 0xB8});                                // mov rax, function
+        emit64(reinterpret_cast<uint64_t>(function));
+        emit({0xFF, 0xD0});                                // call rax
+    }
+
+    // condition codes of the checks of calls
+    static constexpr uint8_t CARRY = 0x2, ZERO = 0x4;
+    // carry = bit 32 of the result of the call, VirtualMachine::IO_FAILED of read_Input
+    void test_ReadFailed()  { emit({0x48, 0x0F, 0xBA, 0xE0, 0x20}); }  // bt rax, 32
+    // zero = the call returned false, as write_Output does when it fails
+    void test_WriteFailed() { emit({0x84, 0xC0}); }                    // test al, al
+
+    // if condition: take n instructions from the budget and return counter
+    void exit_If(uint8_t condition, uint32_t n, uint32_t counter)
+    {
+        emit({uint8_t(0x70 | (condition ^ 1)), 0x00});     // jncc skip
+        const size_t skip = get_Size();
+        take_Budget(n);
+        mov_Immediate(0, counter);
+        epilogue();
+        bytes[skip - 1] = uint8_t(get_Size() - skip);      // skip:
+    }
+
+    void save_First()    { emit({0x89, 0x04, 0x24}); }     // mov [rsp], eax
+    void restore_First() { emit({0x8B, 0x04, 0x24}); }     // mov eax, [rsp]
+    void move_ToSecond() { emit({0x89, 0xC1}); }           // mov ecx, eax
+
+    // eax = eax op ecx, in the order of VirtualMachine::ALU_ops
+    void alu(uint8_t operation)
+    {
+        static const unsigned char opcodes[] = {0x01, 0x29, 0x21, 0x09, 0x00, 0x31};
+        if (operation == 4)
+        {
+            emit({0xF7, 0xD0});                            // not eax
+        }
+        else if (operation == 6)
+        {
+            emit({0x0F, 0xAF, 0xC1});                      // imul eax, ecx
+        }
+        else
+        {
+            emit({opcodes[operation], 0xC8});
+        }
+    }
+
+    // condition codes of VirtualMachine::COND_ops, unsigned comparisons of eax to ecx
+    static uint8_t get_ConditionCode(uint8_t operation)
+    {
+        static const unsigned char codes[] = {0x4, 0x5, 0x2, 0x6, 0x7, 0x3};
+        return codes[operation];
+    }
+
+    // eax = condition ? taken : not_taken
+    void select(uint8_t operation, uint32_t taken, uint32_t not_taken)
+    {
+        emit({0x39, 0xC8});                                // cmp eax, ecx
+        mov_Immediate(0, not_taken);
+        mov_Immediate(2, taken);
+        emit({0x0F, uint8_t(0x40 | get_ConditionCode(operation)), 0xC2});  // cmovcc eax, edx
+    }
+
+    // sub r15, n
+    void take_Budget(uint32_t n)
+    {
+        emit({0x49, 0x81, 0xEF});
+        emit32(n);
+    }
+
+    // if there's budget left after take_Budget goto target
+    void jump_IfBudget(size_t target)
+    {
+        emit({0x0F, 0x8F});                                // jg target
+        emit32(uint32_t(target - (bytes.size() + 4)));
+    }
+
+    // right after take_Budget: if there's budget left and condition goto target, otherwise
+    // eax = condition ? taken : not_taken
+    void loop_If(uint8_t operation, size_t target, uint32_t taken, uint32_t not_taken)
+    {
+        emit({0x7E, 0x00});                                // jle out
+        const size_t out = get_Size();
+        emit({0x39, 0xC8});                                // cmp eax, ecx
+        emit({0x0F, uint8_t(0x80 | get_ConditionCode(operation))});
+        emit32(uint32_t(target - (bytes.size() + 4)));     // jcc target
+        mov_Immediate(0, not_taken);
+        emit({0xEB, 0x00});                                // jmp end
+        const size_t end = get_Size();
+        bytes[out - 1] = uint8_t(get_Size() - out);
+        select(operation, taken, not_taken);               // out:
+        bytes[end - 1] = uint8_t(get_Size() - end);        // end:
+    }
+
+    void prologue()
+    {
+        emit({0x53, 0x41, 0x54, 0x41, 0x55});              // push rbx; push r12; push r13
+        emit({0x41, 0x56, 0x41, 0x57});                    // push r14; push r15
+        emit({0x48, 0x83, 0xEC, 0x10});                    // sub rsp, 16
+        emit({0x48, 0x89, 0xFB});                          // mov rbx, rdi
+        emit({0x49, 0x89, 0xF4});                          // mov r12, rsi
+        emit({0x49, 0x89, 0xD5});                          // mov r13, rdx
+        emit({0x49, 0x89, 0xCE});                          // mov r14, rcx
+        emit({0x4D, 0x8B, 0x3E});                          // mov r15, [r14]
+    }
+
+    // return eax
+    void epilogue()
+    {
+        emit({0x4D, 0x89, 0x3E});                          // mov [r14], r15
+        emit({0x48, 0x83, 0xC4, 0x10});                    // add rsp, 16
+        emit({0x41, 0x5F, 0x41, 0x5E});                    // pop r15; pop r14
+        emit({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});        // pop r13; pop r12; pop rbx; ret
+    }
+};
+
+
+
+JitCache::JitCache(const std::vector<char> &memory) : memory(memory), byte_states(memory.size(), DATA)
+{
+#if defined(VM_JIT_SUPPORTED)
+    // without the memory nothing is compiled, see is_Available()
+    void *mapping = mmap(nullptr, CODE_CAPACITY, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping != MAP_FAILED)
+    {
+        code = static_cast<unsigned char *>(mapping);
+        code_capacity = CODE_CAPACITY;
+    }
+#endif
+}
+
+
+JitCache::~JitCache()
+{
+    release_Code();
+}
+
+
+bool JitCache::is_Supported()
+{
+#if defined(VM_JIT_SUPPORTED)
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+const JitCache::Block &JitCache::get_Block(uint32_t counter)
+{
+    auto it = blocks.find(counter);
+    if (it != blocks.end())
+    {
+        return it->second;
+    }
+    return blocks.emplace(counter, compile(counter)).first->second;
+}
+
+
+void JitCache::invalidate(size_t address)
+{
+    bool is_compiled = false;
+    for (size_t i = address; i < address + 4 && i < byte_states.size(); ++i)
+    {
+        is_compiled |= byte_states[i] != DATA;
+        byte_states[i] = SELF_MODIFIED;
+    }
+
+    if (is_compiled)
+    {
+        clear();
+    }
+}
+
+
+void JitCache::release_Code()
+{
+#if defined(VM_JIT_SUPPORTED)
+    if (code)
+    {
+        munmap(code, code_capacity);
+    }
+#endif
+    code = nullptr;
+    code_size = 0;
+    code_capacity = 0;
+}
+
+
+void JitCache::clear()
+{
+    blocks.clear();
+    code_size = 0;
+    for (uint8_t &state : byte_states)
+    {
+        if (state == COMPILED)
+        {
+            state = DATA;
+        }
+    }
+}
+
+
+JitCache::Block JitCache::compile(uint32_t start)
+{
+    using VM = VirtualMachine;
+    if (!code)
+    {
+        return {nullptr, start};
+    }
+    Emitter emitter;
+    emitter.prologue();
+    const size_t body = emitter.get_Size();
+
+    auto is_Source = [this](uint8_t operand, bool is_immediate)
+    {
+        return is_immediate || operand < VM::NUM_REGISTERS || size_t(operand) + 4 <= memory.size();
+    };
+    static_assert(VM::IO_FAILED == uint64_t(1) << 32, "Emitter::test_ReadFailed tests bit 32");
+    // an exception of the IO register leaves the instruction as exec() does, the counter past it
+    auto exit_IfFailed = [&emitter, start](uint8_t condition, uint32_t address)
+    {
+        emitter.exit_If(condition, (address - start) / 4, address + 4);
+    };
+    auto load_Source = [&emitter, &exit_IfFailed](int reg, uint8_t operand, bool is_immediate, uint32_t address)
+    {
+        if (is_immediate)
+            emitter.mov_Immediate(reg, operand);
+        else if (operand < VM::NUM_GP_REGISTERS)
+            emitter.load_Register(reg, operand);
+        else if (operand == VM::COUNTER_INDEX)
+            emitter.mov_Immediate(reg, address + 4);
+        else if (operand == VM::IO_REG_INDEX)
+        {
+            emitter.call(reinterpret_cast<const void *>(&VM::read_Input));
+            emitter.test_ReadFailed();
+            exit_IfFailed(Emitter::CARRY, address);
+            if (reg != 0)
+                emitter.move_ToSecond();
+        }
+        else
+            emitter.load_Memory(reg, operand);
+    };
+
+    uint32_t address = start;
+    bool is_ended = false;
+    for (size_t n = 0; n < MAX_BLOCK_INSTRUCTIONS && !is_ended; ++n, address += 4)
+    {
+        if (size_t(address) + 4 > memory.size())
+            break;
+        bool is_self_modified = false;
+        for (size_t i = address; i < size_t(address) + 4; ++i)
+            is_self_modified |= byte_states[i] == SELF_MODIFIED;
+
+        uint8_t opcode = memory[address], src1 = memory[address + 1], src2 = memory[address + 2];
+        uint8_t dst = memory[address + 3];
+        uint8_t operation = opcode & ~FIRST_IMMEDIATE & ~SECOND_IMMEDIATE & ~VM::CONDITIONAL_BIT;
+        bool is_conditional = opcode & VM::CONDITIONAL_BIT;
+        bool is_first_immediate = opcode & FIRST_IMMEDIATE, is_second_immediate = opcode & SECOND_IMMEDIATE;
+
+        // left to exec(): invalid opcodes, memory out of bounds and stores, which may change code
+        if (is_self_modified || operation >= (is_conditional ? 6 : 7) || (!is_conditional && dst >= VM::NUM_REGISTERS)
+            || !is_Source(src1, is_first_immediate) || !is_Source(src2, is_second_immediate))
+            break;
+
+        // sources in the order exec() reads them, both may be the IO register
+        load_Source(0, src1, is_first_immediate, address);
+        if (!is_second_immediate && src2 == VM::IO_REG_INDEX)
+        {
+            emitter.save_First();
+            load_Source(1, src2, false, address);
+            emitter.restore_First();
+        }
+        else
+        {
+            load_Source(1, src2, is_second_immediate, address);
+        }
+
+        // a jump to the beginning of the block from another instruction loops in compiled code
+        bool is_loop = address != start && (is_conditional ? dst == start : false);
+        if (is_conditional)
+        {
+            // every run through the block takes all its instructions from the budget
+            emitter.take_Budget((address - start) / 4 + 1);
+            if (is_loop)
+            {
+                emitter.loop_If(operation, body, dst, address + 4);
+            }
+            else
+            {
+                emitter.select(operation, dst, address + 4);
+            }
+            is_ended = true;
+            continue;
+        }
+
+        emitter.alu(operation);
+        if (dst < VM::NUM_GP_REGISTERS)
+        {
+            emitter.store_Register(dst);
+        }
+        else if (dst == VM::IO_REG_INDEX)
+        {
+            emitter.call(reinterpret_cast<const void *>(&VM::write_Output));
+            emitter.test_WriteFailed();
+            exit_IfFailed(Emitter::ZERO, address);
+        }
+        else
+        {
+            // the counter, a jump to the result
+            emitter.take_Budget((address - start) / 4 + 1);
+            bool is_constant = (is_first_immediate || src1 == VM::COUNTER_INDEX)
+                               && (is_second_immediate || src2 == VM::COUNTER_INDEX);
+            if (is_constant && address != start)
+            {
+                uint32_t value1 = is_first_immediate ? src1 : address + 4;
+                uint32_t value2 = is_second_immediate ? src2 : address + 4;
+                if (VM::ALU_ops[operation](value1, value2) == start)
+                    emitter.jump_IfBudget(body);
+            }
+            is_ended = true;
+        }
+    }
+
+    if (address == start)
+    {
+        return {nullptr, start};
+    }
+    if (!is_ended)
+    {
+        // continues with the next instruction
+        emitter.take_Budget((address - start) / 4);
+        emitter.mov_Immediate(0, address);
+    }
+    emitter.epilogue();
+
+    const std::vector<unsigned char> &bytes = emitter.get_Bytes();
+    if (code_size + bytes.size() > code_capacity)
+    {
+        clear();
+    }
+    for (size_t i = start; i < address; ++i)
+    {
+        byte_states[i] = COMPILED;
+    }
+
+    BlockFunction function = nullptr;
+#if defined(VM_JIT_SUPPORTED)
+    // only the pages the block goes to are made writable, never at once with executable, which a hardened kernel
+    // may refuse altogether: then the code is dropped and nothing's compiled anymore
+    static const size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+    unsigned char *pages = code + code_size / page_size * page_size;
+    size_t pages_size = code + code_size + bytes.size() - pages;
+    if (mprotect(pages, pages_size, PROT_READ | PROT_WRITE) != 0)
+    {
+        clear();
+        release_Code();
+        return {nullptr, start};
+    }
+    std::memcpy(code + code_size, bytes.data(), bytes.size());
+    if (mprotect(pages, pages_size, PROT_READ | PROT_EXEC) != 0)
+    {
+        clear();
+        release_Code();
+        return {nullptr, start};
+    }
+    function = reinterpret_cast<BlockFunction>(code + code_size);
+    code_size += bytes.size();
+#endif
+    return {function, address - 4};
+}
+
+
+
+bool VirtualMachine::run_Jit(int64_t &budget)
+{
+    if (!JitCache::is_Supported())
+    {
+        return run_Threaded(budget);
+    }
+    if (!jit)
+    {
+        jit = std::make_unique<JitCache>(memory);
+    }
+
+    while (true)
+    {
+        const JitCache::Block &block = jit->get_Block(counter);
+        if (!jit->is_Available())
+        {
+            // no executable memory, between blocks the threaded interpreter can take over
+            return run_Threaded(budget);
+        }
+        uint32_t prev_counter_val = block.last_address;
+        if (block.function)
+        {
+            counter = block.function(gp_registers.data(), memory.data(), this, &budget);
+            if (io_error)
+            {
+                std::rethrow_exception(std::exchange(io_error, nullptr));
+            }
+        }
+        else
+        {
+            // exec() may store into compiled code and drop the block
+            prev_counter_val = counter;
+            exec();
+            --budget;
+        }
+
+        if (counter == prev_counter_val)
+        {
+            return true;
+        }
+        if (budget <= 0)
+        {
+            return false;
+        }
+    }
+}
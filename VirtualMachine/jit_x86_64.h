@@ -0,0 +1,78 @@
+#ifndef __JIT_X86_64_H__
+#define __JIT_X86_64_H__
+
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+#include "virtual_machine.h"
+
+
+
+/*
+ * Basic blocks of VM programs compiled to x86-64 code. A block starts at any counter value and runs to the first
+ * instruction that jumps (a conditional one or an ALU one writing the counter), or up to an instruction that can't be
+ * compiled: an invalid one, one out of memory or one storing into memory. Compiled code works on the registers in
+ * place, reads memory directly and calls back to the VM for the IO register. Compiled frames can't be unwound, so an
+ * exception of the IO register is caught in the call, the block returns right after it and the VM throws it again.
+ * Every run through a block takes its instructions from the budget, and blocks that jump back to their start loop in
+ * compiled code only while there's some left.
+ *
+ * Stores into memory never run as compiled code, so the code can't change under a running block. When one hits an
+ * instruction of a compiled block, all the blocks are dropped and the instructions the store wrote stay with
+ * the interpreter from then on.
+ */
+class JitCache
+{
+public:
+    // run the block on the registers and memory, returns the counter after it
+    using BlockFunction = uint32_t (*) (uint32_t *registers, char *memory, VirtualMachine *vm, int64_t *budget);
+
+    struct Block
+    {
+        // nullptr if the instruction at the counter can't be compiled, it's left to exec()
+        BlockFunction function;
+        // address of the last instruction, jumping from it to itself hangs
+        uint32_t last_address;
+    };
+
+private:
+    const std::vector<char> &memory;
+    std::unordered_map<uint32_t, Block> blocks;
+
+    // what every byte of memory is to the compiler
+    enum ByteState : uint8_t { DATA, COMPILED, SELF_MODIFIED };
+    std::vector<uint8_t> byte_states;
+
+    // executable memory the blocks are compiled into, writable only while compiling
+    unsigned char *code = nullptr;
+    size_t code_size = 0;
+    size_t code_capacity = 0;
+
+public:
+    explicit JitCache(const std::vector<char> &memory);
+    JitCache(const JitCache &) = delete;
+    JitCache& operator=(const JitCache &) = delete;
+    ~JitCache();
+
+    // whether compiled code can run on this platform
+    static bool is_Supported();
+    // whether there's executable memory for the blocks: false if it couldn't be mapped or made executable
+    bool is_Available() const { return code != nullptr; }
+
+    // block at the counter, compiled on the first request
+    const Block &get_Block(uint32_t counter);
+    // the 4 bytes at address were written to
+    void invalidate(size_t address);
+
+private:
+    Block compile(uint32_t address);
+    void clear();
+    // unmap the executable memory, for good
+    void release_Code();
+};
+
+
+#endif
@@ -1,11 +1,49 @@
 #include <iostream>
 #include <fstream>
 #include <exception>
+#include <cstring>
+#include <memory>
 
 
 #include "virtual_machine.h"
 
 
+// engine of the --engine= option
+static VirtualMachine::Engine parse_Engine(const char *name)
+{
+    if (!std::strcmp(name, "interpreter"))
+        return VirtualMachine::Engine::INTERPRETER;
+    if (!std::strcmp(name, "threaded"))
+        return VirtualMachine::Engine::THREADED;
+    if (!std::strcmp(name, "jit"))
+        return VirtualMachine::Engine::JIT;
+
+    std::cerr << "Error: unknown engine " << name << ", expected interpreter, threaded or jit.\n";
+    std::terminate();
+}
+
+// device of the --io= option, nullptr for the standard streams through operator>> and operator<<
+static std::unique_ptr<IODevice> make_Device(const char *name)
+{
+    if (!std::strcmp(name, "stream"))
+        return nullptr;
+
+    bool is_text = !std::strcmp(name, "text");
+    if (!is_text && std::strcmp(name, "binary"))
+    {
+        std::cerr << "Error: unknown IO " << name << ", expected stream, text or binary.\n";
+        std::terminate();
+    }
+
+    // the devices read and write the standard streams in blocks, without stdio in between (which gives the streams
+    // new buffers, so it's done before the device takes them)
+    std::ios::sync_with_stdio(false);
+    if (is_text)
+        return std::make_unique<TextDevice>(&std::cin, &std::cout);
+    return std::make_unique<BinaryDevice>(&std::cin, &std::cout);
+}
+
+
 int main(int argc, const char *argv[])
 {
     if (argc < 2)
@@ -17,6 +55,26 @@ int main(int argc, const char *argv[])
 
     const char *program_filename = argv[1];
 
+    // options after the program: --engine=interpreter|threaded|jit, --io=stream|text|binary
+    VirtualMachine::Engine engine = VirtualMachine::Engine::THREADED;
+    const char *io = "stream";
+    for (int i = 2; i < argc; ++i)
+    {
+        if (!std::strncmp(argv[i], "--engine=", 9))
+        {
+            engine = parse_Engine(argv[i] + 9);
+        }
+        else if (!std::strncmp(argv[i], "--io=", 5))
+        {
+            io = argv[i] + 5;
+        }
+        else
+        {
+            std::cerr << "Error: unknown option " << argv[i] << '\n';
+            std::terminate();
+        }
+    }
+
     std::ifstream program_file {program_filename, std::ios::binary};
 
     if (!program_file)
@@ -32,8 +90,26 @@ int main(int argc, const char *argv[])
     program_file.seekg(0, std::ios::beg);
 
 
+    std::unique_ptr<IODevice> device = make_Device(io);
+
     VirtualMachine vm (1 << 20, &std::cin, &std::cout);
+    vm.connect_Device(device.get());
+    vm.set_Engine(engine);
     vm.upload_Program(program_file);
-    vm.run();
+
+    // what the program wrote before failing is still shown
+    try
+    {
+        vm.run();
+    }
+    catch (...)
+    {
+        if (device)
+        {
+            device->flush();
+        }
+        std::cout.flush();
+        throw;
+    }
 }
 
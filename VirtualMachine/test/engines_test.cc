@@ -0,0 +1,301 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <functional>
+
+
+#include "virtual_machine.h"
+
+
+/*
+ * Equivalence of the engines on random programs: every engine, and the threaded interpreter with every fusion mode,
+ * must leave the registers, memory, counter and output exactly as exec() instruction by instruction does, also when
+ * the program stops on an error. Half of the programs are counted loops storing into their own code, into fused pairs
+ * and compiled blocks as they run.
+ */
+
+using Engine = VirtualMachine::Engine;
+using Fusion = VirtualMachine::Fusion;
+
+// programs exec() doesn't see halting within this many instructions are left out
+static constexpr int MAX_STEPS = 5000;
+
+static int num_failed = 0;
+
+
+struct Outcome
+{
+    std::string error;
+    std::array<uint32_t, VirtualMachine::NUM_GP_REGISTERS> registers;
+    uint32_t counter;
+    std::vector<char> memory;
+    std::string output;
+
+    bool operator==(const Outcome &other) const
+    {
+        return error == other.error && registers == other.registers && counter == other.counter
+               && memory == other.memory && output == other.output;
+    }
+};
+
+
+// state after running the program by 'run' on a fresh VM, "steps" as the error if it didn't halt within MAX_STEPS
+static Outcome run_Program(const std::string &program, size_t memory_size, const std::string &input,
+                           const std::function<void(VirtualMachine &)> &run)
+{
+    std::istringstream program_stream(program), input_stream(input);
+    std::ostringstream output_stream;
+    VirtualMachine vm (memory_size, &input_stream, &output_stream);
+    vm.upload_Program(program_stream);
+
+    Outcome outcome;
+    try
+    {
+        run(vm);
+    }
+    catch (const mem_out_of_bounds_error &)
+    {
+        outcome.error = "memory out of bounds";
+    }
+    catch (const invalid_opcode_error &)
+    {
+        outcome.error = "invalid opcode";
+    }
+    catch (int)
+    {
+        outcome.error = "steps";
+    }
+    outcome.registers = vm.get_Registers();
+    outcome.counter = vm.get_Counter();
+    outcome.memory = vm.get_Memory();
+    outcome.output = output_stream.str();
+    return outcome;
+}
+
+
+// run() bounded by the instructions of the halting programs compared, so that an engine going wrong can't hang
+static void run_Halting(VirtualMachine &vm)
+{
+    if (vm.run_For(2 * MAX_STEPS).reason != VirtualMachine::StopReason::HALTED)
+    {
+        throw 0;
+    }
+}
+
+
+static void append(std::string &program, uint8_t opcode, uint8_t src1, uint8_t src2, uint8_t dst)
+{
+    program += char(opcode);
+    program += char(src1);
+    program += char(src2);
+    program += char(dst);
+}
+
+
+// any register, the IO register, the counter or memory, registers most often
+static uint8_t make_Source(std::mt19937 &rng)
+{
+    uint32_t k = rng() % 12;
+    return k < 8 ? rng() % VirtualMachine::NUM_GP_REGISTERS
+                 : k == 8 ? VirtualMachine::IO_REG_INDEX : k == 9 ? VirtualMachine::COUNTER_INDEX : 16 + rng() % 240;
+}
+
+
+// random instructions jumping anywhere, mostly to the beginnings of instructions, usually ending with a halt
+static std::string make_Program(std::mt19937 &rng)
+{
+    size_t n = 1 + rng() % 60;
+    std::string program;
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint8_t opcode = rng() % 2 ? rng() % VirtualMachine::NUM_ALU_OPS
+                                   : VirtualMachine::CONDITIONAL_BIT | rng() % VirtualMachine::NUM_COND_OPS;
+        // every now and then one of the invalid opcodes
+        if (rng() % 50 == 0)
+        {
+            opcode = rng() % 32;
+        }
+        opcode |= (rng() % 3 == 0 ? FIRST_IMMEDIATE : 0) | (rng() % 3 == 0 ? SECOND_IMMEDIATE : 0);
+
+        uint8_t dst;
+        if (opcode & VirtualMachine::CONDITIONAL_BIT)
+        {
+            uint32_t k = rng() % 10;
+            dst = k < 8 ? 4 * (rng() % (n + 1)) : rng() % 256;
+        }
+        else
+        {
+            uint32_t k = rng() % 12;
+            dst = k < 7 ? rng() % VirtualMachine::NUM_GP_REGISTERS
+                        : k == 7 ? VirtualMachine::IO_REG_INDEX : k == 8 ? VirtualMachine::COUNTER_INDEX : 16 + rng() % 240;
+        }
+        append(program, opcode, make_Source(rng), make_Source(rng), dst);
+    }
+    if (rng() % 4)
+    {
+        append(program, 0xe0, 0, 0, 4 * n);
+    }
+    return program;
+}
+
+
+// r13 = k; body; r13 -= 1; while r13 != 0 go to the body; halt. The body stores into the code: copies of its
+// instructions over each other (so that it goes on running) and values of registers (which mostly ends it)
+static std::string make_Loop(std::mt19937 &rng)
+{
+    size_t n = 4 + rng() % 16;
+    // the loop ends with the decrement and the jump, a fused pair
+    const size_t code_end = 4 * (n + 3);
+    std::string program;
+    append(program, FIRST_IMMEDIATE | SECOND_IMMEDIATE, 1 + rng() % 50, 0, 13);
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint8_t opcode = rng() % VirtualMachine::NUM_ALU_OPS;
+        opcode |= (rng() % 3 == 0 ? FIRST_IMMEDIATE : 0) | (rng() % 3 == 0 ? SECOND_IMMEDIATE : 0);
+        uint8_t src1 = make_Source(rng), src2 = make_Source(rng), dst;
+        uint32_t k = rng() % 20;
+        if (k < 3)
+        {
+            // an instruction at 16 or past it (memory operands begin there) copied over another one
+            opcode = SECOND_IMMEDIATE;
+            src1 = 16 + 4 * (rng() % ((code_end - 16) / 4));
+            src2 = 0;
+            dst = 16 + 4 * (rng() % ((code_end - 16) / 4));
+        }
+        else if (k < 5)
+        {
+            // a value anywhere into the code
+            dst = 16 + rng() % (code_end - 16);
+        }
+        else if (k < 7)
+        {
+            dst = k == 5 ? VirtualMachine::IO_REG_INDEX : 16 + rng() % 240;
+        }
+        else
+        {
+            dst = rng() % 13;
+        }
+        append(program, opcode, src1, src2, dst);
+    }
+    append(program, SECOND_IMMEDIATE | 1, 13, 1, 13);
+    append(program, SECOND_IMMEDIATE | VirtualMachine::CONDITIONAL_BIT | 1, 13, 0, 4);
+    append(program, 0xe0, 0, 0, 4 * (n + 3));
+    return program;
+}
+
+
+static std::string make_Input(std::mt19937 &rng)
+{
+    std::string input;
+    for (int i = 0; i < 500; ++i)
+    {
+        input += std::to_string(rng() % 2 ? rng() % 10 : rng()) + ' ';
+    }
+    return input;
+}
+
+
+int main()
+{
+    std::mt19937 rng(2024);
+    int num_compared = 0;
+    for (int i = 0; i < 3000; ++i)
+    {
+        std::string program = i % 2 ? make_Loop(rng) : make_Program(rng);
+        // memory ending within the reach of the memory operands now and then (upload_Program reads programs in
+        // blocks of 32 bytes, so the size is a multiple of that)
+        size_t memory_size = rng() % 4 ? 1024 : 256;
+        if (program.size() > memory_size)
+        {
+            continue;
+        }
+        std::string input = make_Input(rng);
+
+        Outcome expected = run_Program(program, memory_size, input, [](VirtualMachine &vm)
+        {
+            for (int step = 0; step < MAX_STEPS; ++step)
+            {
+                uint32_t counter = vm.get_Counter();
+                vm.exec();
+                if (vm.get_Counter() == counter)
+                {
+                    return;
+                }
+            }
+            throw 0;
+        });
+        if (expected.error == "steps")
+        {
+            continue;
+        }
+        ++num_compared;
+
+        uint64_t profile_steps = rng() % 100;
+        VirtualMachine::FusionProfile profile {};
+        for (auto &row : profile)
+        {
+            for (uint64_t &count : row)
+            {
+                count = rng() % 3 ? 0 : rng() % 100;
+            }
+        }
+
+        const std::pair<const char *, std::function<void(VirtualMachine &)>> variants[] = {
+            {"interpreter", [](VirtualMachine &vm) { vm.set_Engine(Engine::INTERPRETER); run_Halting(vm); }},
+            {"threaded without fusion", [](VirtualMachine &vm)
+             {
+                 vm.set_Engine(Engine::THREADED);
+                 vm.set_Fusion(Fusion::NONE);
+                 run_Halting(vm);
+             }},
+            {"threaded with every pair fused", [](VirtualMachine &vm)
+             {
+                 vm.set_Engine(Engine::THREADED);
+                 vm.set_Fusion(Fusion::ALL);
+                 run_Halting(vm);
+             }},
+            {"threaded with the recorded profile", [profile_steps](VirtualMachine &vm)
+             {
+                 vm.set_Engine(Engine::THREADED);
+                 vm.set_Fusion(Fusion::PROFILED);
+                 if (vm.record_Profile(profile_steps))
+                 {
+                     run_Halting(vm);
+                 }
+             }},
+            {"threaded with a given profile", [&profile](VirtualMachine &vm)
+             {
+                 vm.set_Engine(Engine::THREADED);
+                 vm.set_FusionProfile(profile);
+                 vm.set_Fusion(Fusion::PROFILED);
+                 run_Halting(vm);
+             }},
+            {"jit", [](VirtualMachine &vm) { vm.set_Engine(Engine::JIT); run_Halting(vm); }},
+        };
+        for (const auto &variant : variants)
+        {
+            Outcome outcome = run_Program(program, memory_size, input, variant.second);
+            if (!(outcome == expected))
+            {
+                std::cout << "FAILED program " << i << " (" << variant.first << "): ";
+                if (outcome.error != expected.error)
+                    std::cout << "error '" << outcome.error << "' instead of '" << expected.error << "'\n";
+                else if (outcome.counter != expected.counter)
+                    std::cout << "counter " << outcome.counter << " instead of " << expected.counter << '\n';
+                else
+                    std::cout << "registers, memory or output differ\n";
+                ++num_failed;
+            }
+        }
+    }
+
+    if (num_failed)
+    {
+        std::cout << num_failed << " runs differ from exec()\n";
+        return 1;
+    }
+    std::cout << "all engines agree with exec() on " << num_compared << " programs\n";
+    return 0;
+}
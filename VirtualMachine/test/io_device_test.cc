@@ -0,0 +1,268 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <random>
+
+
+#include "io_device.h"
+
+
+/*
+ * Checks of the IO devices: TextDevice reads what operator>> of a stream reads into uint32_t (whitespace, signs,
+ * overflow to the maximum, 0s after invalid input) with any buffer size, BinaryDevice reads back what it writes and
+ * 0 for a truncated last value, RingBufferDevice keeps the order of the values across the wrap-around of its rings,
+ * clamps the numbers of values committed and consumed and counts the values it drops.
+ */
+
+static int num_failed = 0;
+
+
+static void check(bool condition, const std::string &what)
+{
+    if (!condition)
+    {
+        std::cout << "FAILED " << what << '\n';
+        ++num_failed;
+    }
+}
+
+
+static std::string escape(const std::string &text)
+{
+    std::string result;
+    for (char c : text)
+    {
+        result += c == '\n' ? "\\n" : c == '\t' ? "\\t" : c == '\r' ? "\\r" : c == '\v' ? "\\v" : c == '\f' ? "\\f"
+                                                                                                 : std::string(1, c);
+    }
+    return result;
+}
+
+
+static void check_TextDevice(std::mt19937 &rng)
+{
+    const char *const pieces[] = {" ", "\n", "\t", "\r\v\f", "-", "+", "0", "7", "12", "4294967295", "4294967296",
+                                  "99999999999999999999", "-4294967295", "-4294967296", "00000000000000000000001",
+                                  "x", "1x"};
+    const size_t num_pieces = sizeof(pieces) / sizeof(pieces[0]);
+    for (int i = 0; i < 20000; ++i)
+    {
+        std::string text;
+        for (uint32_t n = rng() % 8; n > 0; --n)
+        {
+            text += pieces[rng() % num_pieces];
+        }
+        size_t buffer_size = 1 + rng() % 5;
+
+        std::istringstream stream(text), device_input(text);
+        std::ostringstream device_output;
+        TextDevice device(&device_input, &device_output, buffer_size);
+        for (int j = 0; j < 6; ++j)
+        {
+            // a failed stream leaves the value as it is, the device gives 0s
+            uint32_t expected = 0;
+            stream >> expected;
+            uint32_t value = device.read();
+            if (value != expected)
+            {
+                check(false, "TextDevice read " + std::to_string(j) + " of '" + escape(text) + "' with a buffer of "
+                             + std::to_string(buffer_size) + ": " + std::to_string(value) + " instead of "
+                             + std::to_string(expected));
+                break;
+            }
+        }
+    }
+
+    // the values written, one per line as operator<< writes them, whatever the buffer size
+    for (size_t buffer_size = 1; buffer_size <= 12; ++buffer_size)
+    {
+        std::ostringstream expected, output;
+        {
+            TextDevice device(nullptr, &output, buffer_size);
+            for (int j = 0; j < 100; ++j)
+            {
+                uint32_t value = rng() >> (rng() % 32);
+                expected << value << '\n';
+                device.write(value);
+            }
+        }
+        check(output.str() == expected.str(), "TextDevice output with a buffer of " + std::to_string(buffer_size));
+    }
+}
+
+
+static void check_BinaryDevice(std::mt19937 &rng)
+{
+    for (size_t buffer_size = 1; buffer_size <= 9; ++buffer_size)
+    {
+        std::vector<uint32_t> values(50);
+        std::ostringstream output;
+        {
+            BinaryDevice device(nullptr, &output, buffer_size);
+            for (uint32_t &value : values)
+            {
+                value = rng();
+                device.write(value);
+            }
+        }
+        std::string bytes = output.str();
+        check(bytes.size() == 4 * values.size() && bytes.compare(0, 4, std::string{char(values[0] >> 24),
+                                                                                   char(values[0] >> 16),
+                                                                                   char(values[0] >> 8),
+                                                                                   char(values[0])}) == 0,
+              "BinaryDevice output of big-endian values with a buffer of " + std::to_string(buffer_size));
+
+        // all but 1 to 3 bytes of the last value
+        bytes.resize(bytes.size() - 1 - rng() % 3);
+        std::istringstream input(bytes);
+        BinaryDevice device(&input, nullptr, buffer_size);
+        bool is_equal = true;
+        for (size_t i = 0; i + 1 < values.size(); ++i)
+        {
+            is_equal = is_equal && device.read() == values[i];
+        }
+        check(is_equal, "BinaryDevice reading back its output with a buffer of " + std::to_string(buffer_size));
+        check(device.read() == 0 && device.read() == 0,
+              "BinaryDevice read of a truncated last value with a buffer of " + std::to_string(buffer_size));
+    }
+}
+
+
+static void check_RingBufferDevice(std::mt19937 &rng)
+{
+    // rounded up to 8 values
+    RingBufferDevice device(5);
+
+    // committing more than there's space for commits the space
+    RingBufferDevice::Span space = device.get_InputSpace();
+    check(space.size == 8, "RingBufferDevice capacity rounded up to a power of 2");
+    for (size_t i = 0; i < space.size; ++i)
+    {
+        space.values[i] = uint32_t(i + 1);
+    }
+    device.commit_Input(100);
+    check(device.get_InputSpace().size == 0 && !device.push_Input(9), "RingBufferDevice commit_Input clamped");
+    for (uint32_t i = 1; i <= 8; ++i)
+    {
+        check(device.read() == i, "RingBufferDevice read of committed input");
+    }
+    check(device.read() == 0, "RingBufferDevice read of empty input");
+
+    // writing to the full output ring drops the values
+    for (uint32_t i = 0; i < 11; ++i)
+    {
+        device.write(i);
+    }
+    check(device.get_NumDropped() == 3, "RingBufferDevice dropped values counted");
+    device.consume_Output(100);
+    check(device.get_Output().size == 0, "RingBufferDevice consume_Output clamped");
+
+    // random use of both rings against queues, with the rings wrapping around all the time
+    std::deque<uint32_t> input, output;
+    uint32_t next_input = 0, next_output = 0;
+    uint64_t num_dropped = device.get_NumDropped();
+    bool is_ordered = true;
+    for (int i = 0; i < 100000; ++i)
+    {
+        switch (rng() % 6)
+        {
+        case 0:
+        {
+            RingBufferDevice::Span space = device.get_InputSpace();
+            size_t n = rng() % (space.size + 2);
+            for (size_t j = 0; j < std::min(n, space.size); ++j)
+            {
+                space.values[j] = next_input + uint32_t(j);
+            }
+            device.commit_Input(n);
+            for (size_t j = 0; j < std::min(n, space.size); ++j)
+            {
+                input.push_back(next_input++);
+            }
+            break;
+        }
+        case 1:
+        {
+            bool has_space = input.size() < 8;
+            bool is_pushed = device.push_Input(next_input);
+            is_ordered = is_ordered && is_pushed == has_space;
+            if (has_space)
+            {
+                input.push_back(next_input++);
+            }
+            break;
+        }
+        case 2:
+        {
+            uint32_t value = device.read(), expected = 0;
+            if (!input.empty())
+            {
+                expected = input.front();
+                input.pop_front();
+            }
+            is_ordered = is_ordered && value == expected;
+            break;
+        }
+        case 3:
+        {
+            device.write(next_output);
+            if (output.size() < 8)
+            {
+                output.push_back(next_output);
+            }
+            else
+            {
+                ++num_dropped;
+            }
+            ++next_output;
+            break;
+        }
+        case 4:
+        {
+            RingBufferDevice::Span values = device.get_Output();
+            size_t n = rng() % (values.size + 2);
+            is_ordered = is_ordered && values.size <= output.size();
+            for (size_t j = 0; j < std::min(n, values.size) && !output.empty(); ++j)
+            {
+                is_ordered = is_ordered && values.values[j] == output.front();
+                output.pop_front();
+            }
+            device.consume_Output(n);
+            break;
+        }
+        default:
+        {
+            uint32_t value;
+            bool is_popped = device.pop_Output(value);
+            is_ordered = is_ordered && is_popped == !output.empty();
+            if (is_popped && !output.empty())
+            {
+                is_ordered = is_ordered && value == output.front();
+                output.pop_front();
+            }
+        }
+        }
+    }
+    check(is_ordered, "RingBufferDevice values in the order of their writing across the wrap-around");
+    check(device.get_NumDropped() == num_dropped, "RingBufferDevice dropped values counted across the wrap-around");
+}
+
+
+int main()
+{
+    std::mt19937 rng(7);
+    check_TextDevice(rng);
+    check_BinaryDevice(rng);
+    check_RingBufferDevice(rng);
+
+    if (num_failed)
+    {
+        std::cout << num_failed << " checks failed\n";
+        return 1;
+    }
+    std::cout << "all device checks passed\n";
+    return 0;
+}
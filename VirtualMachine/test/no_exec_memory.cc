@@ -0,0 +1,22 @@
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstddef>
+
+
+/*
+ * Preloaded into run_stats_test to run it as under a kernel that doesn't let memory become executable (W^X policies,
+ * SELinux execmem): mprotect fails for PROT_EXEC, so the JIT engine has to fall back to the threaded interpreter.
+ */
+extern "C" int mprotect(void *address, size_t size, int protection)
+{
+    if (protection & PROT_EXEC)
+    {
+        errno = EACCES;
+        return -1;
+    }
+
+    using Mprotect = int (*)(void *, size_t, int);
+    static Mprotect real_mprotect = reinterpret_cast<Mprotect>(dlsym(RTLD_NEXT, "mprotect"));
+    return real_mprotect(address, size, protection);
+}
@@ -0,0 +1,219 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+
+#include "virtual_machine.h"
+
+
+/*
+ * Regression check of run_For(): the sample programs and a few loops written here run on every engine, which must
+ * agree on why they stopped, on the instructions executed when the program halts, and on the output. A program
+ * reported LOOPING is stopped for good, so above all nothing that makes progress may be.
+ */
+
+using Engine = VirtualMachine::Engine;
+using StopReason = VirtualMachine::StopReason;
+
+static const Engine engines[] = {Engine::INTERPRETER, Engine::THREADED, Engine::JIT};
+static const char *const engine_names[] = {"interpreter", "threaded", "jit"};
+static const char *const reason_names[] = {"BUDGET", "HALTED", "LOOPING"};
+
+static int num_failed = 0;
+
+
+struct Case
+{
+    std::string name;
+    std::string program;
+    std::string input;
+    StopReason reason;
+    // budget of the run, for a cycle of n instructions it must allow for its detection within 2n slices of the loop
+    // check, 2^16 instructions each (see VirtualMachine::run_For)
+    uint64_t max_instructions;
+    // instructions of a halting program, 0 if not checked
+    uint64_t instructions = 0;
+    // beginning of the output, if checked
+    std::string output = "";
+};
+
+
+static std::string read_File(const std::string &path)
+{
+    std::ifstream file {path, std::ios::binary};
+    if (!file)
+    {
+        std::cerr << "Error: no file at location " << path << '\n';
+        std::exit(1);
+    }
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+
+static void fail(const Case &test, size_t engine, const std::string &message)
+{
+    std::cout << "FAILED " << test.name << " (" << engine_names[engine] << "): " << message << '\n';
+    ++num_failed;
+}
+
+
+// run the case on every engine, with one run_For() of its budget or with calls of slice instructions each
+static void check(const Case &test, uint64_t slice = 0)
+{
+    const uint64_t max_instructions = test.max_instructions;
+    std::string first_output;
+    for (size_t e = 0; e < 3; ++e)
+    {
+        std::istringstream program(test.program), input(test.input);
+        std::ostringstream output;
+        VirtualMachine vm (1024, &input, &output);
+        vm.set_Engine(engines[e]);
+        vm.upload_Program(program);
+
+        VirtualMachine::RunStats stats;
+        if (slice == 0)
+        {
+            stats = vm.run_For(max_instructions);
+        }
+        else
+        {
+            while (stats.instructions < max_instructions && stats.reason == StopReason::BUDGET)
+            {
+                VirtualMachine::RunStats slice_stats = vm.run_For(slice);
+                stats.instructions += slice_stats.instructions;
+                stats.reason = slice_stats.reason;
+            }
+        }
+
+        if (stats.reason != test.reason)
+        {
+            fail(test, e, std::string("stopped on ") + reason_names[size_t(stats.reason)] + " instead of "
+                          + reason_names[size_t(test.reason)]);
+        }
+        if (test.instructions && stats.instructions != test.instructions)
+        {
+            fail(test, e, std::to_string(stats.instructions) + " instructions instead of "
+                          + std::to_string(test.instructions));
+        }
+        if (stats.reason == StopReason::BUDGET && stats.instructions < max_instructions)
+        {
+            fail(test, e, "stopped on BUDGET before the budget ran out");
+        }
+
+        // the engines stop at different jumps past the budget, so only the output all of them wrote is compared
+        std::string text = output.str();
+        if (text.compare(0, test.output.size(), test.output) != 0)
+        {
+            fail(test, e, "output doesn't begin with the expected one");
+        }
+        if (e == 0)
+        {
+            first_output = text;
+        }
+        else if (text.compare(0, first_output.size(), first_output) != 0
+                 && first_output.compare(0, text.size(), text) != 0)
+        {
+            fail(test, e, "output differs from the interpreter's");
+        }
+    }
+}
+
+
+// a stream throwing on the read past the end of the input leaves run_For() as an exception of exec() does: right after
+// the instruction reading it, with the ones before done and nothing of it
+static void check_FailedInput()
+{
+    // r0 = IO + IO; r1 += 1; IO = r0 + r1; while r1 < 20; hang
+    const Case test = {"failed input", std::string("\x00\x0e\x0e\x00" "\x80\x01\x01\x01" "\x00\x00\x01\x0e"
+                                                   "\xa2\x01\x14\x00" "\xe0\x00\x00\x10", 20),
+                       "1 2 3", StopReason::HALTED, 1'000'000};
+    for (size_t e = 0; e < 3; ++e)
+    {
+        std::istringstream program(test.program), input(test.input);
+        input.exceptions(std::ios::failbit);
+        std::ostringstream output;
+        VirtualMachine vm (1024, &input, &output);
+        vm.set_Engine(engines[e]);
+        vm.upload_Program(program);
+
+        try
+        {
+            vm.run_For(test.max_instructions);
+            fail(test, e, "no exception of the input stream");
+        }
+        catch (const std::ios::failure &)
+        {
+            if (vm.get_Counter() != 4)
+            {
+                fail(test, e, "counter " + std::to_string(vm.get_Counter()) + " instead of 4");
+            }
+            if (vm.get_Registers()[0] != 3 || vm.get_Registers()[1] != 1)
+            {
+                fail(test, e, "r0 " + std::to_string(vm.get_Registers()[0]) + " and r1 "
+                              + std::to_string(vm.get_Registers()[1]) + " instead of 3 and 1");
+            }
+            if (output.str() != "4\n")
+            {
+                fail(test, e, "output differs from the one before the exception");
+            }
+        }
+    }
+}
+
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Error: no directory of the sample programs specified.\n";
+        return 1;
+    }
+    const std::string samples = std::string(argv[1]) + '/';
+
+    const uint64_t budget = 1'000'000;
+    std::vector<Case> cases = {
+        // they write forever, reading 0s once the input is over
+        {"inf_typer", read_File(samples + "inf_typer"), "", StopReason::BUDGET, budget, 0, "255\n255\n"},
+        {"multiplier", read_File(samples + "multiplier"), "3 4 5 6", StopReason::BUDGET, budget, 0, "12\n30\n0\n"},
+
+        // r0 ^= 1 forever: a cycle of 4 instructions
+        {"xor cycle", std::string("\x85\x00\x01\x00" "\xe0\x00\x00\x00", 8), "", StopReason::LOOPING, budget},
+        // r0 = (r0 + 1) & 15 forever: a cycle of 48 instructions, which the engines stopping at the jump after the
+        // budget only see again after several slices
+        {"masked counter", std::string("\x80\x00\x01\x00" "\x82\x00\x0f\x00" "\xe0\x00\x00\x00", 12), "",
+         StopReason::LOOPING, 2 * 48 << 16},
+        // r0 += 1 forever: the state repeats only after 2^33 instructions
+        {"counter", std::string("\x80\x00\x01\x00" "\xe0\x00\x00\x00", 8), "", StopReason::BUDGET, budget},
+        // a store into memory of the same value forever is progress as far as the check knows
+        {"store loop", std::string("\x80\x00\x00\xc8" "\xe0\x00\x00\x00", 8), "", StopReason::BUDGET, budget},
+        // reading the IO register without input forever, likewise
+        {"read loop", std::string("\x80\x0e\x00\x00" "\xe0\x00\x00\x00", 8), "", StopReason::BUDGET, budget},
+        // r1 = 200000; r0 += 1 until it's r1, over several slices of the loop check; hang
+        {"long loop", std::string("\xc0\xc8\x00\x01" "\x86\x01\xfa\x01" "\x86\x01\x04\x01" "\x80\x00\x01\x00"
+                                  "\x21\x00\x01\x0c" "\xe0\x00\x00\x14", 24), "", StopReason::HALTED, budget, 400'004},
+        // a jump to itself
+        {"hang", std::string("\xe0\x00\x00\x00", 4), "", StopReason::HALTED, budget, 1},
+    };
+
+    for (const Case &test : cases)
+    {
+        check(test);
+    }
+    // the loop check carries over from one call to the next
+    for (const Case &test : cases)
+    {
+        check(test, 1000);
+    }
+    check_FailedInput();
+
+    if (num_failed)
+    {
+        std::cout << num_failed << " checks failed\n";
+        return 1;
+    }
+    std::cout << "all " << 2 * cases.size() + 1 << " cases passed on every engine\n";
+    return 0;
+}
@@ -0,0 +1,474 @@
+#include "virtual_machine.h"
+
+#include <algorithm>
+
+
+/*
+ * Threaded interpreter. Every instruction at an address divisible by 4 is decoded once, on its first execution,
+ * into a micro-op: the index of the code executing it (the handler) and operands that need no more masking. The first
+ * execution decodes the rest of the basic block too, up to the first micro-op that may jump.
+ * Handlers jump right to the handler of the next micro-op with computed goto, so there's neither a fetch nor a central
+ * dispatch loop. Stores into memory drop the micro-ops of the instructions they overwrite, which are decoded again.
+ *
+ * Register and immediate operands of micro-ops are indices into a single array of values: the registers come first,
+ * immediate v is at IMMEDIATE_OPERAND + v. Operations on those only (the common case) have a handler each, the rest
+ * (IO register, counter and memory operands) go through get_SrcValue and set_DstValue. Whatever the micro-ops can't
+ * do (invalid opcodes, instructions out of memory, counters not divisible by 4) is left to exec(). Micro-ops run in
+ * order between jumps, so the instructions executed are counted on jumps, from the address jumped to before.
+ *
+ * Pairs of an ALU operation on values and the next micro-op, when that's one on values as well or a conditional jump
+ * on values, are fused into superinstructions: the handler of the first micro-op is replaced by one running both
+ * operations, which reads the operands of the second one from its own micro-op. That micro-op stays as it is for
+ * jumps right to it, and a store into it decodes the micro-op before it again, unfused. Which pairs are fused is up to
+ * set_Fusion: all of them, or the kinds of pairs that ran often in a run recorded by record_Profile.
+ */
+
+
+// operand index of immediate 0
+static constexpr uint16_t IMMEDIATE_OPERAND = 256;
+// number of operand values: registers and immediates
+static constexpr size_t NUM_OPERAND_VALUES = IMMEDIATE_OPERAND + 256;
+// most micro-ops decoded at once
+static constexpr size_t MAX_BLOCK_MICRO_OPS = 64;
+
+// kinds of the second micro-op of a fused pair: ALU operations on values, then conditional jumps on values
+static constexpr size_t NUM_FUSION_KINDS = VirtualMachine::NUM_ALU_OPS + VirtualMachine::NUM_COND_OPS;
+
+
+// fused pairs of ALU operation first and fusion kind second
+#define FOR_EACH_FUSED_SECOND(F, first)                                                \
+    F(first, 0) F(first, 1) F(first, 2) F(first, 3) F(first, 4) F(first, 5)           \
+    F(first, 6) F(first, 7) F(first, 8) F(first, 9) F(first, 10) F(first, 11)         \
+    F(first, 12)
+#define FOR_EACH_FUSED(F)                                                              \
+    FOR_EACH_FUSED_SECOND(F, 0) FOR_EACH_FUSED_SECOND(F, 1)                            \
+    FOR_EACH_FUSED_SECOND(F, 2) FOR_EACH_FUSED_SECOND(F, 3)                            \
+    FOR_EACH_FUSED_SECOND(F, 4) FOR_EACH_FUSED_SECOND(F, 5)                            \
+    FOR_EACH_FUSED_SECOND(F, 6)
+
+#define FUSED_NAME(first, second) FUSED_##first##_##second,
+
+
+enum Handler : uint8_t
+{
+    DECODE,
+    EXEC,
+    // ALU operations on register or immediate sources to register
+    ALU_ADD, ALU_SUB, ALU_AND, ALU_OR, ALU_NOT, ALU_XOR, ALU_MUL,
+    // ALU operation on any operands
+    ALU_ANY,
+    // conditional jumps on register or immediate sources
+    IF_EQ, IF_NOT_EQ, IF_LESS, IF_LESS_OR_EQ, IF_GREATER, IF_GREATER_OR_EQ,
+    // conditional jump on any sources
+    IF_ANY,
+    // fused pairs of micro-ops
+    FOR_EACH_FUSED(FUSED_NAME)
+};
+
+static_assert(FUSED_6_12 + 1 == FUSED_0_0 + VirtualMachine::NUM_ALU_OPS * NUM_FUSION_KINDS,
+              "Every pair of ALU operation and fusion kind needs a handler.");
+
+
+static inline bool is_Value(uint16_t operand)
+{
+    return operand < VirtualMachine::NUM_GP_REGISTERS || operand >= IMMEDIATE_OPERAND;
+}
+
+
+// result of the ALU operation, in the order of ALU_ops
+static inline uint32_t compute_Alu(uint8_t operation, uint32_t src1, uint32_t src2)
+{
+    switch (operation)
+    {
+        case 0:  return src1 + src2;
+        case 1:  return src1 - src2;
+        case 2:  return src1 & src2;
+        case 3:  return src1 | src2;
+        case 4:  return ~src1;
+        case 5:  return src1 ^ src2;
+        default: return src1 * src2;
+    }
+}
+
+
+// condition of the conditional operation, in the order of COND_ops
+static inline bool is_ConditionMet(uint8_t operation, uint32_t src1, uint32_t src2)
+{
+    switch (operation)
+    {
+        case 0:  return src1 == src2;
+        case 1:  return src1 != src2;
+        case 2:  return src1 <  src2;
+        case 3:  return src1 <= src2;
+        case 4:  return src1 >  src2;
+        default: return src1 >= src2;
+    }
+}
+
+
+VirtualMachine::MicroOp VirtualMachine::decode_MicroOp(uint32_t address) const
+{
+    MicroOp micro_op;
+    micro_op.handler = EXEC;
+    if (size_t(address) + 4 > memory.size())
+    {
+        return micro_op;
+    }
+
+    uint8_t opcode = memory[address];
+    uint8_t operation = opcode & ~FIRST_IMMEDIATE & ~SECOND_IMMEDIATE & ~CONDITIONAL_BIT;
+    micro_op.operation = operation;
+    micro_op.src1 = uint8_t(memory[address + 1]) + (opcode & FIRST_IMMEDIATE ? IMMEDIATE_OPERAND : 0);
+    micro_op.src2 = uint8_t(memory[address + 2]) + (opcode & SECOND_IMMEDIATE ? IMMEDIATE_OPERAND : 0);
+    micro_op.dst = memory[address + 3];
+    bool are_values = is_Value(micro_op.src1) && is_Value(micro_op.src2);
+
+    // invalid opcodes stay with exec(), which throws
+    if (opcode & CONDITIONAL_BIT)
+    {
+        if (operation < sizeof(COND_ops) / sizeof(COND_op))
+        {
+            micro_op.handler = are_values ? IF_EQ + operation : IF_ANY;
+        }
+    }
+    else if (operation < sizeof(ALU_ops) / sizeof(ALU_op))
+    {
+        micro_op.handler = are_values && micro_op.dst < NUM_GP_REGISTERS ? ALU_ADD + operation : ALU_ANY;
+    }
+    return micro_op;
+}
+
+
+// fusion kind of the micro-op, or of the first micro-op of a fused pair, -1 if it's neither of them
+static int get_FusionKind(uint8_t handler)
+{
+    if (handler >= ALU_ADD && handler <= ALU_MUL)
+    {
+        return handler - ALU_ADD;
+    }
+    if (handler >= IF_EQ && handler <= IF_GREATER_OR_EQ)
+    {
+        return VirtualMachine::NUM_ALU_OPS + handler - IF_EQ;
+    }
+    if (handler >= FUSED_0_0)
+    {
+        return (handler - FUSED_0_0) / NUM_FUSION_KINDS;
+    }
+    return -1;
+}
+
+
+void VirtualMachine::decode_Block(size_t index)
+{
+    // ALU operations on values never jump, the block goes on after them
+    size_t end = index;
+    do
+    {
+        decoded[end] = decode_MicroOp(uint32_t(end) * 4);
+        ++end;
+    } while (end < decoded.size() && end - index < MAX_BLOCK_MICRO_OPS && decoded[end].handler == DECODE
+             && decoded[end - 1].handler >= ALU_ADD && decoded[end - 1].handler <= ALU_MUL);
+
+    if (fusion == Fusion::NONE)
+    {
+        return;
+    }
+    for (size_t i = index; i < end && i + 1 < decoded.size(); ++i)
+    {
+        int first = get_FusionKind(decoded[i].handler);
+        int second = get_FusionKind(decoded[i + 1].handler);
+        if (first >= 0 && size_t(first) < NUM_ALU_OPS && second >= 0 && is_Fused(first, second))
+        {
+            decoded[i].handler = FUSED_0_0 + first * NUM_FUSION_KINDS + second;
+        }
+    }
+}
+
+
+bool VirtualMachine::is_Fused(size_t first, size_t second) const
+{
+    if (fusion != Fusion::PROFILED)
+    {
+        return fusion == Fusion::ALL;
+    }
+
+    // kinds of pairs that make at least 1% of the recorded ones
+    uint64_t total = 0;
+    for (auto &counts : fusion_profile)
+    {
+        for (uint64_t count : counts)
+        {
+            total += count;
+        }
+    }
+    uint64_t count = fusion_profile[first][second];
+    return count != 0 && count >= total / 100;
+}
+
+
+void VirtualMachine::set_Fusion(Fusion fusion)
+{
+    this->fusion = fusion;
+    decoded.clear();
+}
+
+
+void VirtualMachine::set_FusionProfile(const FusionProfile &profile)
+{
+    fusion_profile = profile;
+    decoded.clear();
+}
+
+
+bool VirtualMachine::record_Profile(uint64_t num_instructions)
+{
+    decoded.clear();
+
+    // fusion kind of the previous instruction if it's an ALU operation on values, which never jumps
+    int prev_kind = -1;
+    for (uint64_t i = 0; i < num_instructions; ++i)
+    {
+        uint32_t address = counter;
+        int kind = address % 4 == 0 ? get_FusionKind(decode_MicroOp(address).handler) : -1;
+        if (prev_kind >= 0 && kind >= 0)
+        {
+            ++fusion_profile[prev_kind][kind];
+        }
+
+        exec();
+        if (counter == address)
+        {
+            return false;
+        }
+        prev_kind = kind >= 0 && size_t(kind) < NUM_ALU_OPS ? kind : -1;
+    }
+    return true;
+}
+
+
+// computed goto is a GNU extension, other compilers dispatch by a switch
+#if defined(__GNUC__) && !defined(VM_NO_COMPUTED_GOTO)
+#define VM_COMPUTED_GOTO
+#endif
+
+#if defined(VM_COMPUTED_GOTO)
+#define HANDLER(name) name
+#define DISPATCH() goto *handlers[micro_op->handler]
+#else
+#define HANDLER(name) case name
+#define DISPATCH() goto dispatch
+#endif
+
+// continue at the micro-op of the counter, or with exec() if there's none
+#define JUMP()                                                                         \
+    do                                                                                 \
+    {                                                                                  \
+        if (counter % 4 != 0 || counter / 4 >= decoded.size())                         \
+            goto exec;                                                                 \
+        micro_op = micro_ops + counter / 4;                                            \
+        entry = counter;                                                               \
+        DISPATCH();                                                                    \
+    } while (false)
+
+// jump to target, unless it's the address of the micro-op itself, which hangs, or the budget has run out
+#define JUMP_TO(target)                                                                \
+    do                                                                                 \
+    {                                                                                  \
+        uint32_t address = uint32_t(micro_op - micro_ops) * 4;                         \
+        counter = (target);                                                            \
+        budget -= (address - entry) / 4 + 1;                                           \
+        if (counter == address)                                                        \
+            goto hang;                                                                 \
+        if (budget <= 0)                                                               \
+            goto stop;                                                                 \
+        JUMP();                                                                        \
+    } while (false)
+
+// the operands go straight into compute_Alu, which folds to the operation and drops the second one of NOT
+#define ALU_HANDLER(name, operation)                                                   \
+    HANDLER(name):                                                                     \
+    {                                                                                  \
+        values[micro_op->dst] =                                                        \
+            compute_Alu(operation, values[micro_op->src1], values[micro_op->src2]);    \
+        ++micro_op;                                                                    \
+        DISPATCH();                                                                    \
+    }
+
+// first micro-op, then the second one, which may jump
+#define FUSED_HANDLER(first, second)                                                   \
+    HANDLER(FUSED_##first##_##second):                                                 \
+    {                                                                                  \
+        uint32_t src1 = values[micro_op->src1], src2 = values[micro_op->src2];         \
+        values[micro_op->dst] = compute_Alu(first, src1, src2);                        \
+        ++micro_op;                                                                    \
+        src1 = values[micro_op->src1];                                                 \
+        src2 = values[micro_op->src2];                                                 \
+        if (second < NUM_ALU_OPS)                                                      \
+            values[micro_op->dst] = compute_Alu(second, src1, src2);                   \
+        else if (is_ConditionMet(uint8_t(second - NUM_ALU_OPS), src1, src2))           \
+            JUMP_TO(micro_op->dst);                                                    \
+        ++micro_op;                                                                    \
+        DISPATCH();                                                                    \
+    }
+
+#define FUSED_ADDRESS(first, second) &&FUSED_##first##_##second,
+
+#define IF_HANDLER(name, condition)                                                    \
+    HANDLER(name):                                                                     \
+    {                                                                                  \
+        uint32_t src1 = values[micro_op->src1], src2 = values[micro_op->src2];         \
+        if (condition)                                                                 \
+            JUMP_TO(micro_op->dst);                                                    \
+        ++micro_op;                                                                    \
+        DISPATCH();                                                                    \
+    }
+
+
+bool VirtualMachine::run_Threaded(int64_t &budget)
+{
+    // a micro-op for every 4 bytes of memory and one past them, which is left to exec() to throw
+    if (decoded.empty())
+    {
+        decoded.resize(memory.size() / 4 + 1);
+    }
+    MicroOp *const micro_ops = decoded.data();
+    MicroOp *micro_op = micro_ops;
+    // address the micro-ops run from since the last jump
+    uint32_t entry = counter;
+
+    uint32_t values[NUM_OPERAND_VALUES];
+    std::copy(gp_registers.begin(), gp_registers.end(), values);
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        values[IMMEDIATE_OPERAND + i] = i;
+    }
+
+    // source value of any operand, the counter being past the instruction
+    auto get_Value = [&](uint16_t operand)
+    {
+        return is_Value(operand) ? values[operand] : operand == COUNTER_INDEX ? counter : get_SrcValue(operand);
+    };
+
+#if defined(VM_COMPUTED_GOTO)
+    static const void *const handlers[] = {
+        &&DECODE, &&EXEC,
+        &&ALU_ADD, &&ALU_SUB, &&ALU_AND, &&ALU_OR, &&ALU_NOT, &&ALU_XOR, &&ALU_MUL, &&ALU_ANY,
+        &&IF_EQ, &&IF_NOT_EQ, &&IF_LESS, &&IF_LESS_OR_EQ, &&IF_GREATER, &&IF_GREATER_OR_EQ, &&IF_ANY,
+        FOR_EACH_FUSED(FUSED_ADDRESS)
+    };
+#endif
+
+    try
+    {
+        JUMP();
+
+#if !defined(VM_COMPUTED_GOTO)
+    dispatch:
+        switch (micro_op->handler)
+        {
+#endif
+
+        HANDLER(DECODE):
+            decode_Block(micro_op - micro_ops);
+            DISPATCH();
+
+        HANDLER(EXEC):
+            counter = uint32_t(micro_op - micro_ops) * 4;
+            budget -= (counter - entry) / 4;
+            goto exec;
+
+        ALU_HANDLER(ALU_ADD, 0)
+        ALU_HANDLER(ALU_SUB, 1)
+        ALU_HANDLER(ALU_AND, 2)
+        ALU_HANDLER(ALU_OR,  3)
+        ALU_HANDLER(ALU_NOT, 4)
+        ALU_HANDLER(ALU_XOR, 5)
+        ALU_HANDLER(ALU_MUL, 6)
+
+        HANDLER(ALU_ANY):
+        {
+            counter = uint32_t(micro_op - micro_ops) * 4 + 4;
+            uint32_t src1 = get_Value(micro_op->src1);
+            uint32_t src2 = get_Value(micro_op->src2);
+            uint32_t result = ALU_ops[micro_op->operation](src1, src2);
+
+            if (micro_op->dst < NUM_GP_REGISTERS)
+            {
+                values[micro_op->dst] = result;
+            }
+            else if (micro_op->dst == COUNTER_INDEX)
+            {
+                JUMP_TO(result);
+            }
+            else
+            {
+                // a store may drop the micro-op of the next instruction, which is then decoded again
+                set_DstValue(micro_op->dst, result);
+            }
+            ++micro_op;
+            DISPATCH();
+        }
+
+        IF_HANDLER(IF_EQ,            src1 == src2)
+        IF_HANDLER(IF_NOT_EQ,        src1 != src2)
+        IF_HANDLER(IF_LESS,          src1 <  src2)
+        IF_HANDLER(IF_LESS_OR_EQ,    src1 <= src2)
+        IF_HANDLER(IF_GREATER,       src1 >  src2)
+        IF_HANDLER(IF_GREATER_OR_EQ, src1 >= src2)
+
+        HANDLER(IF_ANY):
+        {
+            counter = uint32_t(micro_op - micro_ops) * 4 + 4;
+            uint32_t src1 = get_Value(micro_op->src1);
+            uint32_t src2 = get_Value(micro_op->src2);
+            if (is_ConditionMet(micro_op->operation, src1, src2))
+            {
+                JUMP_TO(micro_op->dst);
+            }
+            ++micro_op;
+            DISPATCH();
+        }
+
+        FOR_EACH_FUSED(FUSED_HANDLER)
+
+#if !defined(VM_COMPUTED_GOTO)
+        }
+#endif
+
+    exec:
+        // instructions without micro-ops, until the counter gets to one that has a micro-op
+        std::copy(values, values + NUM_GP_REGISTERS, gp_registers.begin());
+        do
+        {
+            uint32_t prev_counter_val = counter;
+            exec();
+            --budget;
+            std::copy(gp_registers.begin(), gp_registers.end(), values);
+            if (counter == prev_counter_val)
+            {
+                return true;
+            }
+            if (budget <= 0)
+            {
+                return false;
+            }
+        } while (counter % 4 != 0 || counter / 4 >= decoded.size());
+        micro_op = micro_ops + counter / 4;
+        entry = counter;
+        DISPATCH();
+
+    hang:
+        std::copy(values, values + NUM_GP_REGISTERS, gp_registers.begin());
+        return true;
+
+    stop:
+        std::copy(values, values + NUM_GP_REGISTERS, gp_registers.begin());
+        return false;
+    }
+    catch (...)
+    {
+        // the registers as the instruction that threw left them
+        std::copy(values, values + NUM_GP_REGISTERS, gp_registers.begin());
+        throw;
+    }
+}
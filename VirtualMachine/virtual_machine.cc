@@ -1,12 +1,22 @@
 #include "virtual_machine.h"
+#include "jit_x86_64.h"
 
 #include <cstdio>
 #include <string>
+#include <algorithm>
+#include <limits>
+
+
+// most instructions run between two checks for loops
+static constexpr uint64_t LOOP_CHECK_INSTRUCTIONS = 1 << 16;
 
 
 VirtualMachine::VirtualMachine(size_t mem_size, std::istream *input,
                                std::ostream *output, uint32_t counter_val)
-: memory(mem_size), input(input), output(output), counter(counter_val), gp_registers({}) {}
+: memory(mem_size), gp_registers({}), counter(counter_val), stream_device(input, output) {}
+
+
+VirtualMachine::~VirtualMachine() = default;
 
 
 void VirtualMachine::upload_Program(std::istream &program)
@@ -27,6 +37,10 @@ void VirtualMachine::upload_Program(std::istream &program)
     {
         throw vm_error("Program size larger than memory limit.");
     }
+
+    decoded.clear();
+    jit.reset();
+    loop_check = LoopCheck();
 }
 
 
@@ -39,14 +53,8 @@ uint32_t VirtualMachine::get_SrcValue(uint8_t src)
     }
     else if (src == IO_REG_INDEX)
     {
-        if (input)
-        {
-            *input >> val;
-        }
-        else
-        {
-            val = 0;
-        }
+        ++num_effects;
+        val = device ? device->read() : stream_device.read();
     }
     else if (src == COUNTER_INDEX)
     {
@@ -61,10 +69,10 @@ uint32_t VirtualMachine::get_SrcValue(uint8_t src)
         }
         else
         {
-            val  = memory[addr++] << 24;
-            val |= memory[addr++] << 16;
-            val |= memory[addr++] << 8;
-            val |= memory[addr++];
+            val  = uint8_t(memory[addr++]) << 24;
+            val |= uint8_t(memory[addr++]) << 16;
+            val |= uint8_t(memory[addr++]) << 8;
+            val |= uint8_t(memory[addr++]);
         }
     }
 
@@ -80,9 +88,14 @@ void VirtualMachine::set_DstValue(uint8_t dst, uint32_t value)
     }
     else if (dst == IO_REG_INDEX)
     {
-        if (output)
+        ++num_effects;
+        if (device)
+        {
+            device->write(value);
+        }
+        else
         {
-            *output << value << '\n';
+            stream_device.write(value);
         }
     }
     else if (dst == COUNTER_INDEX)
@@ -91,15 +104,66 @@ void VirtualMachine::set_DstValue(uint8_t dst, uint32_t value)
     }
     else
     {
-        if (dst + 4 >= memory.size())
+        if (dst + 4 > memory.size())
         {
             throw mem_out_of_bounds_error("Couldn't write at memory address out of memory bounds.");
         }
 
-        memory[dst] = value >> 24;
-        memory[dst] = value >> 16;
-        memory[dst] = value >> 8;
-        memory[dst] = value;
+        memory[dst]     = value >> 24;
+        memory[dst + 1] = value >> 16;
+        memory[dst + 2] = value >> 8;
+        memory[dst + 3] = value;
+        ++num_effects;
+        invalidate_Code(dst);
+    }
+}
+
+
+void VirtualMachine::invalidate_Code(size_t address)
+{
+    for (size_t i = address / 4; i <= (address + 3) / 4 && i < decoded.size(); ++i)
+    {
+        decoded[i] = MicroOp();
+    }
+    // the micro-op before them may be fused with the first one, it's decoded again on its own
+    size_t prev = address / 4 - 1;
+    if (address >= 4 && prev < decoded.size() && decoded[prev].handler != 0)
+    {
+        decoded[prev] = decode_MicroOp(uint32_t(prev) * 4);
+    }
+
+    if (jit)
+    {
+        jit->invalidate(address);
+    }
+}
+
+
+uint64_t VirtualMachine::read_Input(VirtualMachine *vm)
+{
+    try
+    {
+        return vm->get_SrcValue(IO_REG_INDEX);
+    }
+    catch (...)
+    {
+        vm->io_error = std::current_exception();
+        return IO_FAILED;
+    }
+}
+
+
+bool VirtualMachine::write_Output(VirtualMachine *vm, uint32_t value)
+{
+    try
+    {
+        vm->set_DstValue(IO_REG_INDEX, value);
+        return true;
+    }
+    catch (...)
+    {
+        vm->io_error = std::current_exception();
+        return false;
     }
 }
 
@@ -161,23 +225,23 @@ void VirtualMachine::op_IF_GREATER_OR_EQ(uint32_t src1, uint32_t src2, uint32_t
 }
 
 
-VirtualMachine::ALU_op VirtualMachine::ALU_ops[7] = {
+VirtualMachine::ALU_op VirtualMachine::ALU_ops[NUM_ALU_OPS] = {
     op_ADD, op_SUB, op_AND, op_OR, op_NOT, op_XOR, op_MUL
 };
 
-VirtualMachine::COND_op VirtualMachine::COND_ops[6] = {
+VirtualMachine::COND_op VirtualMachine::COND_ops[NUM_COND_OPS] = {
     &VirtualMachine::op_IF_EQ,
     &VirtualMachine::op_IF_NOT_EQ,
     &VirtualMachine::op_IF_LESS,
     &VirtualMachine::op_IF_LESS_OR_EQ,
     &VirtualMachine::op_IF_GREATER,
-    &VirtualMachine::op_IF_GREATER
+    &VirtualMachine::op_IF_GREATER_OR_EQ
 };
 
 
 void VirtualMachine::exec()
 {
-    if (counter + 4 > memory.size())
+    if (size_t(counter) + 4 > memory.size())
     {
         throw mem_out_of_bounds_error("Got out of bounds of memory while trying to read the next instruction.");
     }
@@ -228,12 +292,79 @@ void VirtualMachine::exec()
 
 void VirtualMachine::run()
 {
-    uint32_t prev_counter_val = counter;
+    run_For(std::numeric_limits<uint64_t>::max());
+}
+
+
+/*
+ * The program runs in slices of up to LOOP_CHECK_INSTRUCTIONS, the engines stop at the first jump after them. A program
+ * without IO or stores depends on nothing but registers and counter, so when it gets back to the registers and counter
+ * of the end of an earlier slice, it's in a cycle it never leaves. The slices of a cycle end at the same points of it
+ * after at most as many slices as there are instructions in it, so comparing the state to the one of an earlier slice
+ * end finds it. That one is taken again after 1, 2, 4... slices (Brent's cycle detection), so longer cycles are found
+ * in time proportional to their length.
+ */
+VirtualMachine::RunStats VirtualMachine::run_For(uint64_t max_instructions)
+{
+    RunStats stats;
+    while (stats.instructions < max_instructions)
+    {
+        int64_t slice = std::min(max_instructions - stats.instructions, LOOP_CHECK_INSTRUCTIONS);
+        int64_t budget = slice;
+        bool is_halted = engine == Engine::JIT      ? run_Jit(budget)
+                       : engine == Engine::THREADED ? run_Threaded(budget)
+                       :                              run_Interpreter(budget);
+        stats.instructions += slice - budget;
+
+        if (is_halted)
+        {
+            stats.reason = StopReason::HALTED;
+            break;
+        }
+        if (is_Looping())
+        {
+            stats.reason = StopReason::LOOPING;
+            break;
+        }
+    }
+    return stats;
+}
 
-    do
+
+bool VirtualMachine::run_Interpreter(int64_t &budget)
+{
+    while (budget > 0)
     {
-        prev_counter_val = counter;
+        uint32_t prev_counter_val = counter;
         exec();
-    } while (counter != prev_counter_val);
+        --budget;
+        if (counter == prev_counter_val)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool VirtualMachine::is_Looping()
+{
+    bool is_same = loop_check.counter == counter && loop_check.registers == gp_registers;
+    if (loop_check.period != 0 && loop_check.num_effects == num_effects && is_same)
+    {
+        return true;
+    }
+
+    // after any progress the state is taken again right away
+    bool is_progress = loop_check.num_effects != num_effects;
+    if (loop_check.period == 0 || is_progress || ++loop_check.distance == loop_check.period)
+    {
+        loop_check.period = loop_check.period == 0 || is_progress ? 1 : 2 * loop_check.period;
+        loop_check.distance = 0;
+        loop_check.counter = counter;
+        loop_check.registers = gp_registers;
+        loop_check.num_effects = num_effects;
+    }
+    return false;
 }
 
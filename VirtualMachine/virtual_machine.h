@@ -9,6 +9,10 @@
 #include <stdexcept>
 #include <vector>
 #include <array>
+#include <memory>
+#include <exception>
+
+#include "io_device.h"
 
 
 
@@ -51,8 +55,14 @@ public:
 
 
 
+class JitCache;
+
+
 class VirtualMachine
 {
+    // compiles instructions with the operations and IO access of the VM
+    friend class JitCache;
+
 public:
     // total number of registers
     static constexpr size_t NUM_REGISTERS = 16;
@@ -65,6 +75,55 @@ public:
     static constexpr size_t COUNTER_INDEX = NUM_GP_REGISTERS + 1;
     // bit defining that an instruction is a conditional jump
     static constexpr size_t CONDITIONAL_BIT = 32;
+    // numbers of ALU and conditional operations
+    static constexpr size_t NUM_ALU_OPS = 7;
+    static constexpr size_t NUM_COND_OPS = 6;
+
+    // how run() executes the program
+    enum class Engine
+    {
+        // instruction by instruction with exec()
+        INTERPRETER,
+        // instructions decoded once into micro-ops and dispatched by threaded code (threaded_interpreter.cc)
+        THREADED,
+        // basic blocks compiled to x86-64 code (jit_x86_64.cc), THREADED where that's not supported
+        JIT
+    };
+
+    // pairs of instructions the threaded interpreter runs as single superinstructions, when the first one is an ALU
+    // operation on registers and immediates to a register and the second one such an operation or a conditional jump
+    // on registers and immediates
+    enum class Fusion
+    {
+        // every instruction on its own
+        NONE,
+        // all of those pairs
+        ALL,
+        // the kinds of pairs frequent in the profile (record_Profile, set_FusionProfile)
+        PROFILED
+    };
+
+    // how many times each ALU operation of such a pair ran right before each ALU operation (the first NUM_ALU_OPS)
+    // and each conditional jump (the rest)
+    using FusionProfile = std::array<std::array<uint64_t, NUM_ALU_OPS + NUM_COND_OPS>, NUM_ALU_OPS>;
+
+    // why run_For() returned
+    enum class StopReason
+    {
+        // the instruction budget ran out
+        BUDGET,
+        // an instruction left the counter unchanged
+        HALTED,
+        // the program came back to an earlier state without IO or stores in between, so it loops forever
+        LOOPING
+    };
+
+    struct RunStats
+    {
+        // instructions executed, including the one that halted
+        uint64_t instructions = 0;
+        StopReason reason = StopReason::BUDGET;
+    };
 
 private:
     // RAM basically
@@ -74,15 +133,53 @@ private:
     // counter register
     uint32_t counter;
 
-    // input stream connected to input register
-    std::istream *input = nullptr;
-    // output stream connected to output register
-    std::ostream *output = nullptr;
+    // streams connected to the IO register, unless there's a device connected
+    StreamDevice stream_device;
+    IODevice *device = nullptr;
+
+    Engine engine = Engine::INTERPRETER;
+    Fusion fusion = Fusion::ALL;
+    FusionProfile fusion_profile = {};
+
+    // instruction decoded for the threaded interpreter
+    struct MicroOp
+    {
+        // index of the code executing the micro-op, 0 until the instruction is decoded
+        uint8_t handler = 0;
+        // index of the ALU or conditional operation
+        uint8_t operation = 0;
+        uint8_t dst = 0;
+        // registers and memory addresses as in the instruction, immediates moved above them (see threaded_interpreter.cc)
+        uint16_t src1 = 0;
+        uint16_t src2 = 0;
+    };
+
+    // micro-ops of the instructions at addresses divisible by 4, decoded a basic block at a time on the first execution
+    std::vector<MicroOp> decoded;
+    // compiled basic blocks, created by the first run of the JIT engine
+    std::unique_ptr<JitCache> jit;
+    // exception of an IO access from compiled code, thrown again once the block returns
+    std::exception_ptr io_error;
+
+    // IO register accesses and stores into memory, the only progress a program makes besides registers and counter
+    uint64_t num_effects = 0;
+    // state of the program at the end of an earlier slice of run_For(), compared to the ones after it
+    struct LoopCheck
+    {
+        uint32_t counter = 0;
+        std::array<uint32_t, NUM_GP_REGISTERS> registers = {};
+        uint64_t num_effects = 0;
+        // slices since the state was taken, it's taken again after period of them
+        uint64_t distance = 0;
+        // 0 while there's no state
+        uint64_t period = 0;
+    } loop_check;
 
 public:
 
     explicit VirtualMachine(size_t mem_size, std::istream *input = nullptr,
                    std::ostream *output = nullptr, uint32_t counter_val = 0);
+    ~VirtualMachine();
 
     auto &get_Memory()    const { return memory; }
     auto &get_Registers() const { return gp_registers; }
@@ -91,29 +188,72 @@ public:
 
     inline void connect_Input(std::istream *input)
     {
-        this->input = input;
+        stream_device.connect_Input(input);
     }
 
     inline void connect_Output(std::ostream *output)
     {
-        this->output = output;
+        stream_device.connect_Output(output);
+    }
+
+    // IO register reads from and writes to the device instead of the streams, back to them with nullptr
+    inline void connect_Device(IODevice *device)
+    {
+        this->device = device;
     }
 
+    inline void set_Engine(Engine engine)
+    {
+        this->engine = engine;
+    }
+
+    void set_Fusion(Fusion fusion);
+    auto &get_FusionProfile() const { return fusion_profile; }
+    // profile of an earlier run, possibly of another VM running the same program
+    void set_FusionProfile(const FusionProfile &profile);
+
 
     // upload program from input stream to memory
     void upload_Program(std::istream &program);
     // execute single instruction and increase counter by the size of instruction
     void exec();
-    // run until counter stops changing (hanging)
+    // run until counter stops changing (hanging) or the program loops forever without IO or stores
     void run();
+    // run up to about max_instructions instructions: the budget is checked on jumps, so the instructions up to the
+    // next jump may run past it. Loops are detected on the way, also across calls.
+    RunStats run_For(uint64_t max_instructions);
+    // run up to num_instructions instructions like exec(), adding the pairs of them to the fusion profile,
+    // false if the program hung within them
+    bool record_Profile(uint64_t num_instructions);
 
 private:
+    // run_For() of the engines: until the program halts (true) or a jump finds the budget run out (false), the budget
+    // decreased by the instructions executed
+    bool run_Interpreter(int64_t &budget);
+    bool run_Threaded(int64_t &budget);
+    // decode the instruction at address into a micro-op
+    MicroOp decode_MicroOp(uint32_t address) const;
+    // decode the micro-ops from the one at index to the end of its basic block and fuse their pairs
+    void decode_Block(size_t index);
+    // whether the pair of ALU operation first and fusion kind second (see threaded_interpreter.cc) is fused
+    bool is_Fused(size_t first, size_t second) const;
+    bool run_Jit(int64_t &budget);
+    // whether the program is in the same state as at the end of an earlier slice, see run_For()
+    bool is_Looping();
+    // drop the micro-ops and compiled code of the instructions the 4 bytes written at address overlap
+    void invalidate_Code(size_t address);
+
     // calculate source value from src register or memory
     // read from register if src < NUM_REGISTERS, otherwise read from memory
     uint32_t get_SrcValue(uint8_t src);
     // set destination value
     // write to register if dst < NUM_REGISTERS, otherwise write to memory
     void set_DstValue(uint8_t dst, uint32_t value);
+    // IO register access for compiled code, which can't unwind: an exception is kept in io_error for run_Jit() to
+    // rethrow, and read_Input returns IO_FAILED, write_Output false
+    static uint64_t read_Input(VirtualMachine *vm);
+    static bool write_Output(VirtualMachine *vm, uint32_t value);
+    static constexpr uint64_t IO_FAILED = uint64_t(1) << 32;
 
     static uint32_t op_ADD(uint32_t src1, uint32_t src2);
     static uint32_t op_SUB(uint32_t src1, uint32_t src2);
@@ -133,8 +273,8 @@ private:
     using ALU_op = uint32_t (*) (uint32_t, uint32_t);
     using COND_op = void (VirtualMachine::*) (uint32_t, uint32_t, uint32_t);
 
-    static ALU_op ALU_ops[7];
-    static COND_op COND_ops[6];
+    static ALU_op ALU_ops[NUM_ALU_OPS];
+    static COND_op COND_ops[NUM_COND_OPS];
 };
 
 